@@ -0,0 +1,198 @@
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <random>
+#include <span>
+#include <vector>
+
+#include "memorychain.h"
+
+// MemoryChain random access benchmark.
+//
+// Prints one JSON object per line, for chains of 10, 100 and 10000 fragments:
+//  - "slice": slice() at random offsets, walking the chain and with an offset index,
+//  - "scan": summing all elements through the byte iterator and per segment,
+//  - "find": finding a delimiter at the end of the chain, with find() and std::find.
+//
+// Usage: bench_memorychain [operations]
+
+typedef std::chrono::steady_clock Clock;
+typedef etl::MemoryChain<uint8_t> MemoryChain;
+
+static constexpr size_t fragmentSize = 64;
+
+static double nanoseconds(Clock::duration duration)
+{
+    return std::chrono::duration<double, std::nano>(duration).count();
+}
+
+static void slice(size_t fragments, size_t operations, size_t entries)
+{
+    std::vector<uint8_t> data(fragments * fragmentSize);
+    std::vector<MemoryChain> nodes(fragments);
+
+    MemoryChain chain;
+    for(size_t i = 0; i < fragments; i++)
+    {
+        nodes[i] = MemoryChain(&data[i * fragmentSize], fragmentSize);
+        chain.add(nodes[i]);
+    }
+
+    for(size_t i = 0; i < data.size(); i++)
+    {
+        data[i] = static_cast<uint8_t>(i);
+    }
+
+    std::vector<MemoryChain::Index::Entry> storage(entries > 0 ? entries : 1);
+    MemoryChain::Index index(storage.data(), storage.size());
+    if(entries > 0)
+    {
+        chain.attach(index);
+    }
+
+    std::mt19937_64 random(42);
+    std::uniform_int_distribution<size_t> offsets(0, chain.length() - 16);
+    std::vector<size_t> workload(operations);
+    for(size_t& offset : workload)
+    {
+        offset = offsets(random);
+    }
+
+    uint8_t buffer[16];
+    size_t sum = 0;
+
+    // Sum the first and last sliced byte, the same with and without an index.
+    const auto start = Clock::now();
+    for(size_t offset : workload)
+    {
+        size_t length = sizeof(buffer);
+        const uint8_t* s = chain.slice(buffer, offset, length);
+        sum += s[0] + s[length - 1];
+    }
+    const double elapsed = nanoseconds(Clock::now() - start);
+
+    printf("{\"benchmark\":\"slice\",\"fragments\":%zu,\"index_entries\":%zu,\"operations\":%zu,"
+            "\"ns_per_operation\":%.2f,\"checksum\":%zu}\n",
+            fragments, entries, operations, elapsed / operations, sum % 1000);
+}
+
+static void scan(size_t fragments, size_t operations)
+{
+    std::vector<uint8_t> data(fragments * fragmentSize);
+    std::vector<MemoryChain> nodes(fragments);
+
+    MemoryChain chain;
+    for(size_t i = 0; i < fragments; i++)
+    {
+        nodes[i] = MemoryChain(&data[i * fragmentSize], fragmentSize);
+        chain.add(nodes[i]);
+    }
+
+    for(size_t i = 0; i < data.size(); i++)
+    {
+        data[i] = static_cast<uint8_t>(i);
+    }
+
+    const size_t passes = (operations + data.size() - 1) / data.size();
+    size_t sum = 0;
+    size_t sumSegments = 0;
+
+    auto start = Clock::now();
+    for(size_t pass = 0; pass < passes; pass++)
+    {
+        sum += std::accumulate(chain.begin(), chain.end(), size_t(0));
+    }
+    const double elapsed = nanoseconds(Clock::now() - start);
+
+    start = Clock::now();
+    for(size_t pass = 0; pass < passes; pass++)
+    {
+        for(std::span<const uint8_t> segment : chain.segments())
+        {
+            sumSegments += std::accumulate(segment.begin(), segment.end(), size_t(0));
+        }
+    }
+    const double elapsedSegments = nanoseconds(Clock::now() - start);
+
+    assert(sum == sumSegments);
+
+    const size_t elements = passes * data.size();
+
+    printf("{\"benchmark\":\"scan\",\"fragments\":%zu,\"elements\":%zu,"
+            "\"ns_per_element\":%.3f,\"ns_per_element_segments\":%.3f,\"checksum\":%zu,\"checksum_segments\":%zu}\n",
+            fragments, elements, elapsed / elements, elapsedSegments / elements, sum % 1000, sumSegments % 1000);
+}
+
+static void find(size_t fragments, size_t operations)
+{
+    std::vector<uint8_t> data(fragments * fragmentSize, 'a');
+    std::vector<MemoryChain> nodes(fragments);
+
+    MemoryChain chain;
+    for(size_t i = 0; i < fragments; i++)
+    {
+        nodes[i] = MemoryChain(&data[i * fragmentSize], fragmentSize);
+        chain.add(nodes[i]);
+    }
+
+    // A delimiter straddling the last two fragments:
+    data[data.size() - fragmentSize - 1] = '\r';
+    data[data.size() - fragmentSize] = '\n';
+
+    const uint8_t delimiter[] = { '\r', '\n' };
+    const size_t passes = (operations + data.size() - 1) / data.size();
+    size_t found = 0;
+    size_t foundIterator = 0;
+
+    auto start = Clock::now();
+    for(size_t pass = 0; pass < passes; pass++)
+    {
+        size_t offset = 0;
+        found += chain.find(delimiter, sizeof(delimiter), offset) ? offset : 0;
+    }
+    const double elapsed = nanoseconds(Clock::now() - start);
+
+    start = Clock::now();
+    for(size_t pass = 0; pass < passes; pass++)
+    {
+        foundIterator += std::distance(chain.begin(), std::search(chain.begin(), chain.end(), delimiter, delimiter + 2));
+    }
+    const double elapsedIterator = nanoseconds(Clock::now() - start);
+
+    assert(found == foundIterator);
+
+    const size_t elements = passes * data.size();
+
+    printf("{\"benchmark\":\"find\",\"fragments\":%zu,\"elements\":%zu,"
+            "\"ns_per_element\":%.3f,\"ns_per_element_iterator\":%.3f,\"checksum\":%zu,\"checksum_iterator\":%zu}\n",
+            fragments, elements, elapsed / elements, elapsedIterator / elements, found % 1000, foundIterator % 1000);
+}
+
+auto main(int argc, char* argv[]) -> int
+{
+    const size_t operations = (argc > 1) ? strtoul(argv[1], nullptr, 0) : 1000000;
+
+    for(size_t fragments : { 10, 100, 10000 })
+    {
+        slice(fragments, operations, 0);
+        slice(fragments, operations, fragments);
+        slice(fragments, operations, (fragments + 7) / 8);
+    }
+
+    for(size_t fragments : { 10, 100, 10000 })
+    {
+        scan(fragments, operations * 10);
+    }
+
+    for(size_t fragments : { 10, 100, 10000 })
+    {
+        find(fragments, operations * 10);
+    }
+}
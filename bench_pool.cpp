@@ -0,0 +1,326 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "pool.h"
+#include "queue.h"
+
+// Pool allocation benchmark against malloc/free and new/delete.
+//
+// Prints one JSON object per line, for every allocator and element size:
+//  - "single": take + release latency on one thread,
+//  - "cross": take on one thread and release on another, the elements pass through a queue,
+//    the latency is measured on the taking thread,
+//  - "scaling": take + release throughput of a number of threads sharing the allocator.
+// Latencies are measured over batches of operations and reported as percentiles per operation.
+//
+// Usage: bench_pool [operations] [max threads]
+
+typedef std::chrono::steady_clock Clock;
+
+static constexpr size_t batch = 64;
+
+template<size_t Size>
+struct Element
+{
+    uint8_t bytes[Size];
+};
+
+static void pin(unsigned cpu)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu % std::max(1u, std::thread::hardware_concurrency()), &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)cpu;
+#endif
+}
+
+static double nanoseconds(Clock::duration duration)
+{
+    return std::chrono::duration<double, std::nano>(duration).count();
+}
+
+static void report(const char* benchmark, const char* allocator, size_t size, size_t threads,
+        size_t operations, double elapsed, std::vector<double>& latencies)
+{
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p)
+    {
+        return latencies.empty() ? 0.0 : latencies[static_cast<size_t>(p * (latencies.size() - 1))];
+    };
+
+    printf("{\"benchmark\":\"%s\",\"allocator\":\"%s\",\"element_size\":%zu,\"threads\":%zu,\"operations\":%zu,"
+            "\"ns_per_operation\":%.2f,\"operations_per_second\":%.0f,"
+            "\"p50_ns\":%.2f,\"p90_ns\":%.2f,\"p99_ns\":%.2f,\"p999_ns\":%.2f}\n",
+            benchmark, allocator, size, threads, operations,
+            elapsed / operations, operations * 1e9 / elapsed,
+            percentile(0.5), percentile(0.9), percentile(0.99), percentile(0.999));
+}
+
+// The allocators under test, all with the same interface.
+
+template<size_t Size>
+class PoolAllocator
+{
+private:
+    etl::Pool<Element<Size>> pool;
+
+public:
+    static constexpr const char* name = "pool";
+
+    explicit PoolAllocator(size_t elements) :
+            pool(elements)
+    {
+    }
+
+    void* take()
+    {
+        return pool.take();
+    }
+
+    void release(void* element)
+    {
+        pool.release(*static_cast<Element<Size>*>(element));
+    }
+};
+
+template<size_t Size>
+class MallocAllocator
+{
+public:
+    static constexpr const char* name = "malloc";
+
+    explicit MallocAllocator(size_t)
+    {
+    }
+
+    void* take()
+    {
+        return malloc(Size);
+    }
+
+    void release(void* element)
+    {
+        free(element);
+    }
+};
+
+template<size_t Size>
+class NewAllocator
+{
+public:
+    static constexpr const char* name = "new";
+
+    explicit NewAllocator(size_t)
+    {
+    }
+
+    void* take()
+    {
+        return new Element<Size>;
+    }
+
+    void release(void* element)
+    {
+        delete static_cast<Element<Size>*>(element);
+    }
+};
+
+template<typename Allocator, size_t Size>
+static void single(size_t operations)
+{
+    Allocator allocator(batch);
+    void* elements[batch];
+
+    std::vector<double> latencies;
+    latencies.reserve(operations / batch);
+
+    const auto start = Clock::now();
+    for(size_t i = 0; i < operations; i += batch)
+    {
+        const auto begin = Clock::now();
+        for(size_t j = 0; j < batch; j++)
+        {
+            elements[j] = allocator.take();
+            memset(elements[j], 0, 8);
+        }
+        for(size_t j = 0; j < batch; j++)
+        {
+            allocator.release(elements[j]);
+        }
+        latencies.push_back(nanoseconds(Clock::now() - begin) / batch);
+    }
+    const double elapsed = nanoseconds(Clock::now() - start);
+
+    report("single", Allocator::name, Size, 1, operations, elapsed, latencies);
+}
+
+template<typename Allocator, size_t Size>
+static void cross(size_t operations)
+{
+    constexpr size_t capacity = 1024;
+
+    Allocator allocator(capacity + batch);
+    etl::Queue<void*, uint32_t> queue(capacity);
+
+    std::thread releaser([&]()
+    {
+        pin(1);
+
+        void* element;
+        size_t released = 0;
+        while(released < operations)
+        {
+            if(queue.dequeue(element))
+            {
+                allocator.release(element);
+                released++;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    pin(0);
+
+    std::vector<double> latencies;
+    latencies.reserve(operations / batch);
+
+    const auto start = Clock::now();
+    for(size_t i = 0; i < operations; i += batch)
+    {
+        const auto begin = Clock::now();
+        for(size_t j = 0; j < batch && i + j < operations; j++)
+        {
+            void* element;
+            while((element = allocator.take()) == nullptr)
+            {
+                std::this_thread::yield();
+            }
+            memset(element, 0, 8);
+
+            while(!queue.enqueue(element))
+            {
+                std::this_thread::yield();
+            }
+        }
+        latencies.push_back(nanoseconds(Clock::now() - begin) / batch);
+    }
+    releaser.join();
+    const double elapsed = nanoseconds(Clock::now() - start);
+
+    report("cross", Allocator::name, Size, 2, operations, elapsed, latencies);
+}
+
+template<typename Allocator, size_t Size>
+static void scaling(size_t operations, size_t threads)
+{
+    Allocator allocator(threads * batch);
+    std::atomic<size_t> ready = 0;
+    std::atomic<bool> go = false;
+    std::vector<std::vector<double>> latencies(threads);
+
+    std::vector<std::thread> workers;
+    for(size_t t = 0; t < threads; t++)
+    {
+        workers.emplace_back([&, t]()
+        {
+            pin(t);
+            void* elements[batch];
+            latencies[t].reserve(operations / threads / batch);
+
+            ready++;
+            while(!go.load())
+            {
+            }
+
+            for(size_t i = 0; i < operations / threads; i += batch)
+            {
+                const auto begin = Clock::now();
+                for(size_t j = 0; j < batch; j++)
+                {
+                    while((elements[j] = allocator.take()) == nullptr)
+                    {
+                        std::this_thread::yield();
+                    }
+                    memset(elements[j], 0, 8);
+                }
+                for(size_t j = 0; j < batch; j++)
+                {
+                    allocator.release(elements[j]);
+                }
+                latencies[t].push_back(nanoseconds(Clock::now() - begin) / batch);
+            }
+        });
+    }
+
+    while(ready.load() < threads)
+    {
+        std::this_thread::yield();
+    }
+
+    const auto start = Clock::now();
+    go = true;
+    for(std::thread& worker : workers)
+    {
+        worker.join();
+    }
+    const double elapsed = nanoseconds(Clock::now() - start);
+
+    std::vector<double> all;
+    for(std::vector<double>& thread : latencies)
+    {
+        all.insert(all.end(), thread.begin(), thread.end());
+    }
+
+    // Throughput of all threads together.
+    report("scaling", Allocator::name, Size, threads, operations, elapsed, all);
+}
+
+template<template<size_t> typename Allocator, size_t Size>
+static void run(size_t operations, size_t maxThreads)
+{
+    single<Allocator<Size>, Size>(operations);
+    cross<Allocator<Size>, Size>(operations);
+
+    for(size_t threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        scaling<Allocator<Size>, Size>(operations, threads);
+    }
+}
+
+template<size_t Size>
+static void run(size_t operations, size_t maxThreads)
+{
+    run<PoolAllocator, Size>(operations, maxThreads);
+    run<MallocAllocator, Size>(operations, maxThreads);
+    run<NewAllocator, Size>(operations, maxThreads);
+}
+
+auto main(int argc, char* argv[]) -> int
+{
+    const size_t operations = (argc > 1) ? strtoul(argv[1], nullptr, 0) : 10000000;
+    const size_t maxThreads = (argc > 2) ? strtoul(argv[2], nullptr, 0) : std::max(1u, std::thread::hardware_concurrency());
+
+    run<64>(operations, maxThreads);
+    run<256>(operations, maxThreads);
+    run<1024>(operations, maxThreads);
+}
@@ -0,0 +1,111 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <memory_resource>
+#include <random>
+#include <vector>
+
+#include "poolresource.h"
+
+// Mixed size allocation benchmark of PoolResource against malloc and new.
+//
+// Prints one JSON object per line, for every allocator:
+//  - "mixed": a random mix of allocations from 8 to 4096 bytes, with a window of live allocations,
+//    freed in random order.
+//
+// Usage: bench_poolresource [operations] [live allocations]
+
+typedef std::chrono::steady_clock Clock;
+
+struct Operation
+{
+    size_t size;
+    size_t slot;
+};
+
+static double nanoseconds(Clock::duration duration)
+{
+    return std::chrono::duration<double, std::nano>(duration).count();
+}
+
+// Sizes are distributed logarithmically, small allocations are as common as large ones.
+static std::vector<Operation> workload(size_t operations, size_t live)
+{
+    std::mt19937_64 random(42);
+    std::uniform_int_distribution<unsigned> shift(3, 11);
+    std::uniform_int_distribution<size_t> slot(0, live - 1);
+
+    std::vector<Operation> workload(operations);
+    for(Operation& operation : workload)
+    {
+        const size_t base = size_t(1) << shift(random);
+        operation.size = base + random() % base;
+        operation.slot = slot(random);
+    }
+
+    return workload;
+}
+
+template<typename Allocate, typename Deallocate>
+static void run(const char* allocator, const std::vector<Operation>& operations, size_t live,
+        Allocate allocate, Deallocate deallocate)
+{
+    std::vector<void*> blocks(live, nullptr);
+    std::vector<size_t> sizes(live, 0);
+
+    const auto start = Clock::now();
+    for(const Operation& operation : operations)
+    {
+        if(blocks[operation.slot] != nullptr)
+        {
+            deallocate(blocks[operation.slot], sizes[operation.slot]);
+        }
+
+        void* block = allocate(operation.size);
+        memset(block, 0, 8);
+        blocks[operation.slot] = block;
+        sizes[operation.slot] = operation.size;
+    }
+    for(size_t i = 0; i < live; i++)
+    {
+        if(blocks[i] != nullptr)
+        {
+            deallocate(blocks[i], sizes[i]);
+        }
+    }
+    const double elapsed = nanoseconds(Clock::now() - start);
+
+    printf("{\"benchmark\":\"mixed\",\"allocator\":\"%s\",\"operations\":%zu,\"live\":%zu,"
+            "\"ns_per_operation\":%.2f}\n",
+            allocator, operations.size(), live, elapsed / operations.size());
+}
+
+auto main(int argc, char* argv[]) -> int
+{
+    const size_t operations = (argc > 1) ? strtoul(argv[1], nullptr, 0) : 10000000;
+    const size_t live = (argc > 2) ? strtoul(argv[2], nullptr, 0) : 1000;
+
+    const std::vector<Operation> mix = workload(operations, live);
+
+    run("malloc", mix, live,
+            [](size_t size) { return malloc(size); },
+            [](void* block, size_t) { free(block); });
+
+    run("new", mix, live,
+            [](size_t size) { return static_cast<void*>(new uint8_t[size]); },
+            [](void* block, size_t) { delete[] static_cast<uint8_t*>(block); });
+
+    etl::PoolResource<> resource;
+    run("pool_resource", mix, live,
+            [&resource](size_t size) { return resource.allocate(size); },
+            [&resource](void* block, size_t size) { resource.deallocate(block, size); });
+
+    std::pmr::unsynchronized_pool_resource standard;
+    run("std_unsynchronized_pool_resource", mix, live,
+            [&standard](size_t size) { return standard.allocate(size); },
+            [&standard](void* block, size_t size) { standard.deallocate(block, size); });
+}
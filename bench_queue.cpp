@@ -0,0 +1,231 @@
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "queue.h"
+
+// Queue throughput and latency benchmark.
+//
+// Prints one JSON object per line:
+//  - "single": enqueue + dequeue cost on one thread,
+//  - "spsc": throughput between a producer and a consumer thread,
+//  - "pingpong": round trip latency percentiles through two queues.
+//
+// Usage: bench_queue [operations] [producer cpu] [consumer cpu]
+
+typedef std::chrono::steady_clock Clock;
+
+template<size_t Size>
+struct Element
+{
+    uint8_t bytes[Size];
+};
+
+static void pin(unsigned cpu)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu % std::max(1u, std::thread::hardware_concurrency()), &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)cpu;
+#endif
+}
+
+static double nanoseconds(Clock::duration duration)
+{
+    return std::chrono::duration<double, std::nano>(duration).count();
+}
+
+template<size_t Size>
+static void single(size_t capacity, size_t operations)
+{
+    etl::Queue<Element<Size>, uint32_t> queue(capacity);
+    Element<Size> element = {};
+
+    const size_t batch = capacity / 2;
+
+    auto start = Clock::now();
+    for(size_t i = 0; i < operations; i += batch)
+    {
+        for(size_t j = 0; j < batch; j++)
+        {
+            element.bytes[0] = static_cast<uint8_t>(j);
+            queue.enqueue(element);
+        }
+
+        for(size_t j = 0; j < batch; j++)
+        {
+            queue.dequeue(element);
+        }
+    }
+    const double elapsed = nanoseconds(Clock::now() - start);
+
+    std::vector<Element<Size>> elements(batch);
+
+    start = Clock::now();
+    for(size_t i = 0; i < operations; i += batch)
+    {
+        queue.enqueue(elements.data(), batch);
+        queue.dequeue(elements.data(), batch);
+    }
+    const double elapsedBulk = nanoseconds(Clock::now() - start);
+
+    printf("{\"benchmark\":\"single\",\"element_size\":%zu,\"capacity\":%zu,\"operations\":%zu,"
+            "\"ns_per_element\":%.2f,\"ns_per_element_bulk\":%.2f}\n",
+            Size, capacity, operations, elapsed / operations, elapsedBulk / operations);
+}
+
+template<size_t Size>
+static void spsc(size_t capacity, size_t operations, unsigned producerCpu, unsigned consumerCpu)
+{
+    etl::Queue<Element<Size>, uint32_t> queue(capacity);
+    std::atomic<bool> go = false;
+
+    std::thread producer([&]()
+    {
+        pin(producerCpu);
+
+        while(!go.load())
+        {
+        }
+
+        Element<Size> element = {};
+        for(size_t i = 0; i < operations; )
+        {
+            if(queue.enqueue(element))
+            {
+                i++;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    pin(consumerCpu);
+
+    const auto start = Clock::now();
+    go = true;
+
+    Element<Size> element;
+    for(size_t i = 0; i < operations; )
+    {
+        if(queue.dequeue(element))
+        {
+            i++;
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+    const double elapsed = nanoseconds(Clock::now() - start);
+
+    producer.join();
+
+    printf("{\"benchmark\":\"spsc\",\"element_size\":%zu,\"capacity\":%zu,\"operations\":%zu,"
+            "\"ns_per_element\":%.2f,\"elements_per_second\":%.0f}\n",
+            Size, capacity, operations, elapsed / operations, operations * 1e9 / elapsed);
+}
+
+template<size_t Size>
+static void pingpong(size_t capacity, size_t roundTrips, unsigned pingCpu, unsigned pongCpu)
+{
+    etl::Queue<Element<Size>, uint32_t> ping(capacity);
+    etl::Queue<Element<Size>, uint32_t> pong(capacity);
+
+    std::thread responder([&]()
+    {
+        pin(pongCpu);
+
+        Element<Size> element;
+        for(size_t i = 0; i < roundTrips; i++)
+        {
+            while(!ping.dequeue(element))
+            {
+                std::this_thread::yield();
+            }
+
+            while(!pong.enqueue(element))
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    pin(pingCpu);
+
+    std::vector<double> latencies(roundTrips);
+    Element<Size> element = {};
+
+    for(size_t i = 0; i < roundTrips; i++)
+    {
+        const auto start = Clock::now();
+
+        while(!ping.enqueue(element))
+        {
+            std::this_thread::yield();
+        }
+
+        while(!pong.dequeue(element))
+        {
+            std::this_thread::yield();
+        }
+
+        latencies[i] = nanoseconds(Clock::now() - start);
+    }
+
+    responder.join();
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p)
+    {
+        return latencies.empty() ? 0.0 : latencies[static_cast<size_t>(p * (latencies.size() - 1))];
+    };
+
+    printf("{\"benchmark\":\"pingpong\",\"element_size\":%zu,\"capacity\":%zu,\"round_trips\":%zu,"
+            "\"p50_ns\":%.0f,\"p90_ns\":%.0f,\"p99_ns\":%.0f,\"p999_ns\":%.0f,\"max_ns\":%.0f}\n",
+            Size, capacity, roundTrips,
+            percentile(0.5), percentile(0.9), percentile(0.99), percentile(0.999), percentile(1.0));
+}
+
+template<size_t Size>
+static void run(size_t operations, unsigned producerCpu, unsigned consumerCpu)
+{
+    for(size_t capacity : { 16, 256, 4096 })
+    {
+        single<Size>(capacity, operations);
+        spsc<Size>(capacity, operations, producerCpu, consumerCpu);
+    }
+
+    pingpong<Size>(16, operations / 100, producerCpu, consumerCpu);
+}
+
+auto main(int argc, char* argv[]) -> int
+{
+    const size_t operations = (argc > 1) ? strtoul(argv[1], nullptr, 0) : 10000000;
+    const unsigned producerCpu = (argc > 2) ? strtoul(argv[2], nullptr, 0) : 0;
+    const unsigned consumerCpu = (argc > 3) ? strtoul(argv[3], nullptr, 0) : 1;
+
+    run<8>(operations, producerCpu, consumerCpu);
+    run<64>(operations, producerCpu, consumerCpu);
+    run<256>(operations, producerCpu, consumerCpu);
+    run<1024>(operations, producerCpu, consumerCpu);
+}
@@ -24,15 +24,165 @@
 #ifndef ETL_MEMORYCHAIN_H_
 #define ETL_MEMORYCHAIN_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
+#include <bit>
+#include <iterator>
+#include <ranges>
+#include <span>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#if __has_include(<sys/uio.h>)
+#include <sys/uio.h>
+#define ETL_MEMORYCHAIN_IOVEC
+#endif
+
 // Embedded Template Library
 namespace etl {
 
+// A chain of fragments of T, linked through nodes that the caller owns.
+// The head of a chain caches its tail and total length, so a copy of a head is a snapshot:
+// once the chain is changed through one of them, e.g. add(), the other must not be used anymore.
 template<typename T>
 class MemoryChain
 {
 public:
+    // Offset index over the fragments of a chain, in caller supplied entries.
+    // Once attached to a chain, it is built on the first slice() or gather() and
+    // rebuilt after the chain changed, so finding the fragment for an offset takes O(log n).
+    // With more fragments than entries, every so many fragments are indexed.
+    class Index
+    {
+    public:
+        struct Entry
+        {
+            const MemoryChain* node;
+            size_t offset;
+        };
+
+        Index(Entry* entries, size_t capacity);
+
+    private:
+        friend class MemoryChain;
+
+        Entry* _entries;
+        size_t _capacity;
+        size_t _count = 0;
+        const MemoryChain* _owner = nullptr; // The chain the index was built for, nullptr when not built.
+
+        void build(const MemoryChain* chain);
+
+        const MemoryChain* find(const MemoryChain* chain, size_t& offset);
+    };
+
+    // Read cursor over a chain, that leaves the chain untouched, so several readers can walk it at once.
+    // Fragments added to the chain stay readable, a reader is invalid after take() or next() on its chain.
+    class Reader
+    {
+    public:
+        Reader(const MemoryChain& chain);
+
+        // Copy up to length elements and move past them, returns the number of elements read.
+        size_t read(T* data, size_t length);
+
+        // Like slice(): in-place pointer to the next length elements when they are in one fragment,
+        // else they are copied to data. Sets length to the number of elements available.
+        const T* peek(T* data, size_t& length) const;
+
+        // Move past up to length elements, returns the number of elements skipped.
+        size_t skip(size_t length);
+
+        void rewind();
+
+        size_t position() const;
+
+        size_t remaining() const;
+
+    private:
+        const MemoryChain* _chain;
+        const MemoryChain* _node;
+        size_t _offset = 0; // Offset in the fragment of _node.
+        size_t _position = 0; // Offset in the chain.
+
+        size_t move(T* data, size_t length);
+    };
+
+    // Forward iterator over the elements of a chain, for standard algorithms.
+    // Every increment checks for the end of the fragment, tight loops should use segments() instead.
+    class Iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef T value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const T* pointer;
+        typedef const T& reference;
+
+        Iterator(const MemoryChain* node = nullptr, size_t offset = 0);
+
+        reference operator*() const;
+
+        pointer operator->() const;
+
+        Iterator& operator++();
+
+        Iterator operator++(int);
+
+        bool operator==(const Iterator& other) const;
+
+        // The elements from here to the end of the fragment.
+        std::span<const T> segment() const;
+
+    private:
+        const MemoryChain* _node; // nullptr at the end of the chain.
+        size_t _offset;
+
+        void skipEmpty();
+    };
+
+    // View of the fragments of a chain as spans, empty fragments are left out.
+    class Segments : public std::ranges::view_interface<Segments>
+    {
+    public:
+        class Iterator
+        {
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef std::span<const T> value_type;
+            typedef ptrdiff_t difference_type;
+            typedef std::span<const T> reference;
+
+            Iterator(const MemoryChain* node = nullptr);
+
+            reference operator*() const;
+
+            Iterator& operator++();
+
+            Iterator operator++(int);
+
+            bool operator==(const Iterator& other) const;
+
+        private:
+            const MemoryChain* _node; // nullptr at the end of the chain.
+
+            void skipEmpty();
+        };
+
+        Segments(const MemoryChain* chain = nullptr);
+
+        Iterator begin() const;
+
+        Iterator end() const;
+
+    private:
+        const MemoryChain* _chain;
+    };
+
     MemoryChain(const T* data = nullptr, size_t length = 0);
 
     MemoryChain& add(MemoryChain& fragment);
@@ -45,9 +195,43 @@ public:
 
     size_t length() const;
 
+    // Find the first value, or the first occurrence of pattern, at or after offset.
+    // On success offset is set to the chain offset of the match, ready for slice().
+    // Matches may straddle fragments, single byte elements are compared 16 or 32 at a time.
+    bool find(const T& value, size_t& offset) const;
+
+    bool find(const T* pattern, size_t length, size_t& offset) const;
+
+#ifdef ETL_MEMORYCHAIN_IOVEC
+    // Describe length elements from offset with the fragments, for writev or sendmsg, without copying.
+    // Returns the number of iovecs filled and sets length to the number of elements described,
+    // which is less than requested when the chain is shorter or the iovec array is too small.
+    size_t gather(struct iovec* vector, size_t count, size_t offset, size_t& length) const;
+
+    // Add the first length elements of the iovecs, e.g. filled by readv or recvmsg, without copying.
+    // nodes must hold count chain nodes, that live as long as the chain.
+    MemoryChain& add(MemoryChain* nodes, const struct iovec* vector, size_t count, size_t length);
+#endif
+
+    // Use index to find offsets, until detached. The index must live as long as it is attached.
+    MemoryChain& attach(Index& index);
+
+    void detach();
+
+    Iterator begin() const;
+
+    Iterator end() const;
+
+    Segments segments() const;
+
 private:
     MemoryChain* _next = nullptr;
 
+    // Only valid in the head of a chain, not updated in copies of the head:
+    MemoryChain* _tail = nullptr; // Last node of the chain, nullptr when the head is the last node.
+    size_t _length = 0; // Total length of all fragments in the chain.
+    Index* _index = nullptr; // Attached offset index.
+
     struct {
         const T* data;
         size_t length;
@@ -59,14 +243,317 @@ private:
 
     void takeSome(T* taken, size_t& length);
 
-public:
+    void advance();
+
+    void invalidate();
+
+    const MemoryChain* locate(size_t& offset) const;
 
-    friend class Iterator;
+    static const T* scan(const T* data, size_t length, const T& value);
+
+    static bool matches(const MemoryChain* chain, size_t offset, const T* pattern, size_t length);
 };
 
+template<typename T>
+MemoryChain<T>::Index::Index(Entry* entries, size_t capacity) :
+    _entries(entries),
+    _capacity(capacity)
+{
+    assert(entries != nullptr && capacity > 0);
+}
+
+template<typename T>
+void MemoryChain<T>::Index::build(const MemoryChain* chain)
+{
+    size_t fragments = 0;
+    for(const MemoryChain* node = chain; node != nullptr; node = node->_next)
+    {
+        fragments++;
+    }
+
+    size_t stride = (fragments + _capacity - 1) / _capacity;
+    size_t offset = 0;
+    size_t i = 0;
+
+    _count = 0;
+
+    for(const MemoryChain* node = chain; node != nullptr; node = node->_next, i++)
+    {
+        if(i % stride == 0)
+        {
+            _entries[_count].node = node;
+            _entries[_count].offset = offset;
+            _count++;
+        }
+
+        offset += node->fragment.length;
+    }
+
+    _owner = chain;
+}
+
+template<typename T>
+const MemoryChain<T>* MemoryChain<T>::Index::find(const MemoryChain* chain, size_t& offset)
+{
+    if(_owner != chain)
+    {
+        build(chain);
+    }
+
+    // Last entry at or before offset:
+    size_t low = 0;
+    size_t high = _count;
+    while(high - low > 1)
+    {
+        size_t middle = low + (high - low) / 2;
+
+        if(_entries[middle].offset <= offset)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    offset -= _entries[low].offset;
+
+    return _entries[low].node;
+}
+
+template<typename T>
+MemoryChain<T>::Reader::Reader(const MemoryChain& chain) :
+    _chain(&chain),
+    _node(&chain)
+{
+}
+
+template<typename T>
+size_t MemoryChain<T>::Reader::move(T* data, size_t length)
+{
+    size_t moved = 0;
+
+    while(_node != nullptr && moved < length)
+    {
+        size_t part = _node->fragment.length - _offset;
+        part = (length - moved < part) ? length - moved : part;
+
+        if(data != nullptr)
+        {
+            memcpy(&data[moved], &_node->fragment.data[_offset], part * sizeof(T));
+        }
+
+        moved += part;
+        _offset += part;
+
+        if(_offset == _node->fragment.length)
+        {
+            if(_node->_next == nullptr)
+            {
+                break; // Stay at the end of the last fragment, so later added fragments are read.
+            }
+
+            _node = _node->_next;
+            _offset = 0;
+        }
+    }
+
+    _position += moved;
+
+    return moved;
+}
+
+template<typename T>
+size_t MemoryChain<T>::Reader::read(T* data, size_t length)
+{
+    assert(data != nullptr || length == 0);
+
+    return move(data, length);
+}
+
+template<typename T>
+const T* MemoryChain<T>::Reader::peek(T* data, size_t& length) const
+{
+    assert(data != nullptr);
+
+    if(_node != nullptr && _node->fragment.length - _offset >= length)
+    {
+        return &_node->fragment.data[_offset];
+    }
+
+    Reader reader = *this;
+    length = reader.move(data, length);
+
+    return data;
+}
+
+template<typename T>
+size_t MemoryChain<T>::Reader::skip(size_t length)
+{
+    return move(nullptr, length);
+}
+
+template<typename T>
+void MemoryChain<T>::Reader::rewind()
+{
+    _node = _chain;
+    _offset = 0;
+    _position = 0;
+}
+
+template<typename T>
+size_t MemoryChain<T>::Reader::position() const
+{
+    return _position;
+}
+
+template<typename T>
+size_t MemoryChain<T>::Reader::remaining() const
+{
+    return _chain->_length - _position;
+}
+
+template<typename T>
+MemoryChain<T>::Iterator::Iterator(const MemoryChain* node, size_t offset) :
+    _node(node),
+    _offset(offset)
+{
+    skipEmpty();
+}
+
+template<typename T>
+void MemoryChain<T>::Iterator::skipEmpty()
+{
+    while(_node != nullptr && _offset >= _node->fragment.length)
+    {
+        _offset -= _node->fragment.length;
+        _node = _node->_next;
+    }
+}
+
+template<typename T>
+const T& MemoryChain<T>::Iterator::operator*() const
+{
+    return _node->fragment.data[_offset];
+}
+
+template<typename T>
+const T* MemoryChain<T>::Iterator::operator->() const
+{
+    return &_node->fragment.data[_offset];
+}
+
+template<typename T>
+typename MemoryChain<T>::Iterator& MemoryChain<T>::Iterator::operator++()
+{
+    _offset++;
+
+    if(_offset == _node->fragment.length)
+    {
+        _node = _node->_next;
+        _offset = 0;
+        skipEmpty();
+    }
+
+    return *this;
+}
+
+template<typename T>
+typename MemoryChain<T>::Iterator MemoryChain<T>::Iterator::operator++(int)
+{
+    Iterator previous = *this;
+    ++*this;
+
+    return previous;
+}
+
+template<typename T>
+bool MemoryChain<T>::Iterator::operator==(const Iterator& other) const
+{
+    return _node == other._node && _offset == other._offset;
+}
+
+template<typename T>
+std::span<const T> MemoryChain<T>::Iterator::segment() const
+{
+    if(_node == nullptr)
+    {
+        return std::span<const T>();
+    }
+
+    return std::span<const T>(&_node->fragment.data[_offset], _node->fragment.length - _offset);
+}
+
+template<typename T>
+MemoryChain<T>::Segments::Iterator::Iterator(const MemoryChain* node) :
+    _node(node)
+{
+    skipEmpty();
+}
+
+template<typename T>
+void MemoryChain<T>::Segments::Iterator::skipEmpty()
+{
+    while(_node != nullptr && _node->fragment.length == 0)
+    {
+        _node = _node->_next;
+    }
+}
+
+template<typename T>
+std::span<const T> MemoryChain<T>::Segments::Iterator::operator*() const
+{
+    return std::span<const T>(_node->fragment.data, _node->fragment.length);
+}
+
+template<typename T>
+typename MemoryChain<T>::Segments::Iterator& MemoryChain<T>::Segments::Iterator::operator++()
+{
+    _node = _node->_next;
+    skipEmpty();
+
+    return *this;
+}
+
+template<typename T>
+typename MemoryChain<T>::Segments::Iterator MemoryChain<T>::Segments::Iterator::operator++(int)
+{
+    Iterator previous = *this;
+    ++*this;
+
+    return previous;
+}
+
+template<typename T>
+bool MemoryChain<T>::Segments::Iterator::operator==(const Iterator& other) const
+{
+    return _node == other._node;
+}
+
+template<typename T>
+MemoryChain<T>::Segments::Segments(const MemoryChain* chain) :
+    _chain(chain)
+{
+}
+
+template<typename T>
+typename MemoryChain<T>::Segments::Iterator MemoryChain<T>::Segments::begin() const
+{
+    return Iterator(_chain);
+}
+
+template<typename T>
+typename MemoryChain<T>::Segments::Iterator MemoryChain<T>::Segments::end() const
+{
+    return Iterator();
+}
+
 template<typename T>
 MemoryChain<T>::MemoryChain(const T* data, size_t length) :
     _next(nullptr),
+    _tail(nullptr),
+    _length(length),
     fragment({ .data = data, .length = length})
 {
 }
@@ -74,19 +561,21 @@ MemoryChain<T>::MemoryChain(const T* data, size_t length) :
 template<typename T>
 MemoryChain<T>& MemoryChain<T>::add(MemoryChain<T>& fragment)
 {
+    invalidate();
+
     if(this->fragment.data == nullptr)
     {
+        Index* index = _index;
         *this = fragment;
+        _index = index;
     }
     else
     {
-        MemoryChain* tail = this;
-        while(tail->_next != nullptr)
-        {
-            tail = tail->_next;
-        }
-
+        MemoryChain* tail = (_tail != nullptr) ? _tail : this;
         tail->_next = &fragment;
+
+        _tail = (fragment._tail != nullptr) ? fragment._tail : &fragment;
+        _length += fragment._length;
     }
 
     return *this;
@@ -104,13 +593,7 @@ const T* MemoryChain<T>::slice(T* slice, size_t offset, size_t& length) const
 
     size_t requested = length;
 
-    const MemoryChain* chain = this;
-
-    while(chain != nullptr && chain->fragment.length <= offset)
-    {
-        offset -= chain->fragment.length;
-        chain = chain->_next;
-    }
+    const MemoryChain* chain = locate(offset);
 
     // Provide in-place slice if possible:
     if(chain != NULL && chain->fragment.length >= offset + requested)
@@ -118,11 +601,11 @@ const T* MemoryChain<T>::slice(T* slice, size_t offset, size_t& length) const
         return &chain->fragment.data[offset];
     }
 
-    uint8_t* slice_cursor = slice;
+    T* slice_cursor = slice;
     while(chain != NULL && length > 0)
     {
         size_t copy = (length < chain->fragment.length - offset) ? length : chain->fragment.length - offset;
-        memcpy(slice_cursor, &chain->fragment.data[offset], copy);
+        memcpy(slice_cursor, &chain->fragment.data[offset], copy * sizeof(T));
         length -= copy;
         slice_cursor += copy;
 
@@ -136,29 +619,107 @@ const T* MemoryChain<T>::slice(T* slice, size_t offset, size_t& length) const
     return slice;
 }
 
+template<typename T>
+void MemoryChain<T>::advance()
+{
+    // The next node becomes the head, it takes over the tail, the length and the index of the chain.
+    MemoryChain* tail = (_next == _tail) ? nullptr : _tail;
+    size_t length = _length - fragment.length;
+    Index* index = _index;
+
+    *this = *_next;
+
+    _tail = tail;
+    _length = length;
+    _index = index;
+}
+
+template<typename T>
+void MemoryChain<T>::invalidate()
+{
+    if(_index != nullptr)
+    {
+        _index->_owner = nullptr;
+    }
+}
+
+template<typename T>
+const MemoryChain<T>* MemoryChain<T>::locate(size_t& offset) const
+{
+    const MemoryChain* chain = this;
+
+    if(_index != nullptr && offset < _length)
+    {
+        chain = _index->find(this, offset);
+    }
+
+    while(chain != nullptr && chain->fragment.length <= offset)
+    {
+        offset -= chain->fragment.length;
+        chain = chain->_next;
+    }
+
+    return chain;
+}
+
+template<typename T>
+MemoryChain<T>& MemoryChain<T>::attach(Index& index)
+{
+    _index = &index;
+    invalidate();
+
+    return *this;
+}
+
+template<typename T>
+void MemoryChain<T>::detach()
+{
+    _index = nullptr;
+}
+
+template<typename T>
+typename MemoryChain<T>::Iterator MemoryChain<T>::begin() const
+{
+    return Iterator(this);
+}
+
+template<typename T>
+typename MemoryChain<T>::Iterator MemoryChain<T>::end() const
+{
+    return Iterator();
+}
+
+template<typename T>
+typename MemoryChain<T>::Segments MemoryChain<T>::segments() const
+{
+    return Segments(this);
+}
+
 template<typename T>
 void MemoryChain<T>::takeSome(T* taken, size_t& length)
 {
-    if(fragment.length <= length) // Consume fragment:
+    // Consume whole fragments, then part of the one that is longer than what is left:
+    while(fragment.length <= length)
     {
-        memcpy(taken, fragment.data, fragment.length);
+        memcpy(taken, fragment.data, fragment.length * sizeof(T));
         taken += fragment.length;
         length -= fragment.length;
+        _length -= fragment.length;
         fragment.length = 0;
 
-        if(_next != nullptr && length >= 0)
+        if(_next == nullptr)
         {
-            *this = *_next;
-            takeSome(taken, length);
+            return;
         }
+
+        advance();
     }
-    else
-    {
-        memcpy(taken, fragment.data, length);
-        fragment.data = fragment.data + length;
-        fragment.length -= length;
-        length = 0;
-    }
+
+    memcpy(taken, fragment.data, length * sizeof(T));
+    fragment.data = fragment.data + length;
+    fragment.length -= length;
+    _length -= length;
+    length = 0;
 }
 
 template<typename T>
@@ -166,6 +727,8 @@ size_t MemoryChain<T>::take(T* taken, size_t length)
 {
     assert(taken != NULL);
 
+    invalidate();
+
     size_t took = length;
 
     takeSome(taken, length);
@@ -176,17 +739,20 @@ size_t MemoryChain<T>::take(T* taken, size_t length)
 template<typename T>
 size_t MemoryChain<T>::next(const T*& fragment)
 {
+    invalidate();
+
     fragment = this->fragment.data;
     size_t length = this->fragment.length;
 
     if(_next != nullptr)
     {
-        *this = *_next;
+        advance();
     }
     else
     {
         this->fragment.data = nullptr;
         this->fragment.length = 0;
+        _length = 0;
     }
 
     return length;
@@ -195,18 +761,190 @@ size_t MemoryChain<T>::next(const T*& fragment)
 template<typename T>
 size_t MemoryChain<T>::length() const
 {
-    size_t length = 0;
+    return _length;
+}
 
-    const MemoryChain* chain = this;
+template<typename T>
+const T* MemoryChain<T>::scan(const T* data, size_t length, const T& value)
+{
+    size_t i = 0;
+
+    if constexpr(sizeof(T) == 1 && std::has_unique_object_representations_v<T>)
+    {
+#ifdef __AVX2__
+        const __m256i wide = _mm256_set1_epi8(std::bit_cast<char>(value));
+        for(; i + 32 <= length; i += 32)
+        {
+            __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&data[i]));
+            uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, wide)));
+
+            if(mask != 0)
+            {
+                return &data[i + std::countr_zero(mask)];
+            }
+        }
+#endif
+#ifdef __SSE2__
+        const __m128i narrow = _mm_set1_epi8(std::bit_cast<char>(value));
+        for(; i + 16 <= length; i += 16)
+        {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&data[i]));
+            uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, narrow)));
+
+            if(mask != 0)
+            {
+                return &data[i + std::countr_zero(mask)];
+            }
+        }
+#endif
+    }
+
+    for(; i < length; i++)
+    {
+        if(data[i] == value)
+        {
+            return &data[i];
+        }
+    }
 
-    while(chain != nullptr)
+    return nullptr;
+}
+
+template<typename T>
+bool MemoryChain<T>::matches(const MemoryChain* chain, size_t offset, const T* pattern, size_t length)
+{
+    while(length > 0)
     {
-        length += chain->fragment.length;
+        if(chain == nullptr)
+        {
+            return false;
+        }
+
+        size_t part = (length < chain->fragment.length - offset) ? length : chain->fragment.length - offset;
+
+        for(size_t i = 0; i < part; i++)
+        {
+            if(!(chain->fragment.data[offset + i] == pattern[i]))
+            {
+                return false;
+            }
+        }
+
+        pattern += part;
+        length -= part;
+        offset = 0;
+
         chain = chain->_next;
     }
 
-    return length;
+    return true;
+}
+
+template<typename T>
+bool MemoryChain<T>::find(const T& value, size_t& offset) const
+{
+    return find(&value, 1, offset);
+}
+
+template<typename T>
+bool MemoryChain<T>::find(const T* pattern, size_t length, size_t& offset) const
+{
+    assert(pattern != nullptr || length == 0);
+
+    if(length == 0 || offset + length > _length)
+    {
+        return length == 0 && offset <= _length;
+    }
+
+    size_t start = offset;
+    const MemoryChain* chain = locate(start);
+    size_t position = offset - start; // Chain offset of the fragment.
+
+    // Scan for the first element of the pattern, then compare the rest, also in the next fragments:
+    while(chain != nullptr && position + start + length <= _length)
+    {
+        const T* match = scan(&chain->fragment.data[start], chain->fragment.length - start, pattern[0]);
+
+        if(match == nullptr)
+        {
+            position += chain->fragment.length;
+            start = 0;
+
+            chain = chain->_next;
+        }
+        else
+        {
+            start = match - chain->fragment.data;
+
+            if(position + start + length > _length)
+            {
+                break;
+            }
+
+            if(matches(chain, start + 1, pattern + 1, length - 1))
+            {
+                offset = position + start;
+                return true;
+            }
+
+            start++;
+        }
+    }
+
+    return false;
+}
+
+#ifdef ETL_MEMORYCHAIN_IOVEC
+template<typename T>
+size_t MemoryChain<T>::gather(struct iovec* vector, size_t count, size_t offset, size_t& length) const
+{
+    assert(vector != nullptr || count == 0);
+
+    size_t requested = length;
+    size_t used = 0;
+
+    const MemoryChain* chain = locate(offset);
+
+    while(chain != nullptr && length > 0 && used < count)
+    {
+        size_t part = (length < chain->fragment.length - offset) ? length : chain->fragment.length - offset;
+
+        if(part > 0)
+        {
+            vector[used].iov_base = const_cast<T*>(&chain->fragment.data[offset]);
+            vector[used].iov_len = part * sizeof(T);
+            used++;
+            length -= part;
+        }
+
+        offset = 0;
+
+        chain = chain->_next;
+    }
+
+    length = requested - length;
+
+    return used;
+}
+
+template<typename T>
+MemoryChain<T>& MemoryChain<T>::add(MemoryChain* nodes, const struct iovec* vector, size_t count, size_t length)
+{
+    assert(nodes != nullptr || count == 0);
+
+    for(size_t i = 0; i < count && length > 0; i++)
+    {
+        size_t part = vector[i].iov_len / sizeof(T);
+        part = (length < part) ? length : part;
+
+        nodes[i] = MemoryChain(static_cast<const T*>(vector[i].iov_base), part);
+        add(nodes[i]);
+        length -= part;
+    }
+
+    return *this;
 }
+#endif
 
 } // namespace My
 
@@ -1,121 +1,1788 @@
-/* The MIT License (MIT)
- *
- * Copyright (c) 2021 Mathias Spiessens
- *
- * Permission is hereby granted, free of charge, to any person obtaining a copy
- * of this software, hardware and associated documentation files (the "Solution"), to deal
- * in the Solution without restriction, including without limitation the rights
- * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
- * copies of the Solution, and to permit persons to whom the Solution is
- * furnished to do so, subject to the following conditions:
- *
- * The above copyright notice and this permission notice shall be included in all
- * copies or substantial portions of the Solution.
- *
- * THE SOLUTION IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
- * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
- * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
- * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
- * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
- * OUT OF OR IN CONNECTION WITH THE SOLUTION OR THE USE OR OTHER DEALINGS IN THE
- * SOLUTION.
- */
-
-#ifndef ETL_POOL_H_
-#define ETL_POOL_H_
-
-#include <stdint.h>
-
-#include "queue.h"
-
-namespace etl
-{
-
-/**
- * \brief A pool of DataType elements.
- *
- * A pool can be used to effectively pass big data structures through connections between components.
- * An element can be taken from the pool and passed around by reference.
- * When taking an element the new owner is responsible to give it back to the pool at some point.
- *
- * A pool is thread safe in the sense that the take() and release() can be called concurrently.
- */
-template<typename DataType>
-class Pool
-{
-private:
-	size_t size;
-	DataType* data;
-	Queue<DataType*> available;
-
-public:
-	/**
-	 * \brief Create a heap.
-	 *
-	 * The array of DataType will be allocated on the heap.
-	 *
-	 * \param size The size of the pool in number of DataType.
-	 */
-	explicit Pool(size_t size) :
-			size(size),
-			data(reinterpret_cast<DataType*>(malloc(size * sizeof(DataType)))),
-			available(Queue<DataType*>(size))
-	{
-		for (size_t i = 0; i < size; i++)
-		{
-			available.enqueue(&data[i]);
-		}
-	}
-
-	/**
-	 * \brief Destructor.
-	 *
-	 * Deallocates the array of DataType from the heap.
-	 */
-	~Pool()
-	{
-		free(data);
-	}
-
-	/**
-	 * \brief Is an element available in the pool?
-	 */
-	bool haveAvailable() const
-	{
-		return !available.empty();
-	}
-
-	/**
-	 * \brief Take an element from the pool.
-	 *
-	 * When an element is taken from the pool, the new "owner" is responsible
-	 * to release it back into the pool when it is no longer needed.
-	 *
-	 * \return Pointer to an element if the pool had one available.
-	 * 		nullptr if no element was available.
-	 */
-	DataType* take()
-	{
-		DataType* take = nullptr;
-
-		available.dequeue(take);
-
-		return take;
-	}
-
-	/**
-	 * \brief Release an element into the pool.
-	 *
-	 * \param element The element to be released into the pool.
-	 * \return The element was successfully put in the pool.
-	 * 		When not successful the take-release mechanism was violated.
-	 */
-	bool release(DataType& element)
-	{
-		return available.enqueue(&element);
-	}
-};
-
-} // namespace etl
-
-#endif // ETL_POOL_H_
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Mathias Spiessens
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software, hardware and associated documentation files (the "Solution"), to deal
+ * in the Solution without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Solution, and to permit persons to whom the Solution is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Solution.
+ *
+ * THE SOLUTION IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOLUTION OR THE USE OR OTHER DEALINGS IN THE
+ * SOLUTION.
+ */
+
+#ifndef ETL_POOL_H_
+#define ETL_POOL_H_
+
+#include <assert.h>
+#include <malloc.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if __has_include(<sys/mman.h>) && __has_include(<unistd.h>)
+#include <sys/mman.h>
+#include <unistd.h>
+#define ETL_POOL_MMAP 1
+#else
+#define ETL_POOL_MMAP 0
+#endif
+
+#ifndef ETL_CACHE_LINE_SIZE
+/**
+ * \brief Size in bytes of a data cache line on the target.
+ *
+ * Define as 1 on targets without a data cache to drop the padding.
+ */
+#define ETL_CACHE_LINE_SIZE 64
+#endif
+
+/**
+ * \def ETL_POOL_STATISTICS
+ * \brief Define to record statistics of every pool, see statistics().
+ *
+ * \def ETL_POOL_DEBUG
+ * \brief Define to keep track of every taken element, with one bit per element.
+ * Releasing an element that is not taken is then always detected,
+ * and destructing a pool asserts that no elements leaked, see leaked().
+ */
+
+namespace etl
+{
+
+#ifdef ETL_POOL_STATISTICS
+/**
+ * \brief Statistics of a pool.
+ *
+ * Sample taken and released over time for the take and release rates.
+ */
+struct PoolStatistics
+{
+	size_t taken; // Number of elements taken since creation.
+	size_t released; // Number of elements released since creation.
+	size_t inUse; // Number of elements taken and not yet released.
+	size_t peak; // Highest number of elements in use.
+	size_t exhausted; // Number of take calls that found no element available.
+};
+#endif
+
+namespace detail
+{
+
+/**
+ * \brief Index of an element in a pool.
+ *
+ * Free elements store the index of the next free element in place.
+ */
+typedef std::conditional_t<(sizeof(void*) >= 8), uint32_t, uint16_t> Link;
+
+/**
+ * \brief Lock-free LIFO of free elements (Treiber stack).
+ *
+ * The free elements are linked through their own storage, the owner of the elements passes
+ * links to every call: links(index) gives access to the link stored in the element at index,
+ * for any index for which links.valid(index) holds.
+ * The head packs the index of the top element with a generation count.
+ * Every pop changes the generation, so a head that was popped and pushed again
+ * in the meantime does not compare equal (ABA).
+ * A pop can read the link of a top element that another thread just took and is writing to,
+ * the exchange then fails and the value read is discarded.
+ *
+ * An empty free list is all zero bits, so a pool with a constant initialized free list
+ * needs no initialized data.
+ */
+class FreeList
+{
+private:
+	typedef std::conditional_t<(sizeof(void*) >= 8), uint64_t, uint32_t> Head;
+
+	static constexpr unsigned shift = sizeof(Link) * 8;
+
+	std::atomic<Head> head;
+	std::atomic<size_t> count;
+
+	static Link top(Head head)
+	{
+		// The index is stored inverted, so none is stored as zero.
+		return static_cast<Link>(~head);
+	}
+
+	static Head pack(Link top, Head generation)
+	{
+		return (generation << shift) | static_cast<Link>(~top);
+	}
+
+	static Head generation(Head head)
+	{
+		return head >> shift;
+	}
+
+	template<typename Links>
+	static std::atomic_ref<Link> link(const Links& links, Link index)
+	{
+		return std::atomic_ref<Link>(links(index));
+	}
+
+public:
+	static constexpr Link none = std::numeric_limits<Link>::max();
+
+	constexpr FreeList() :
+			head(0),
+			count(0)
+	{
+	}
+
+	/**
+	 * \brief Push free elements, linked from first to last.
+	 *
+	 * \param count The number of elements from first to last.
+	 */
+	template<typename Links>
+	void push(const Links& links, Link first, Link last, size_t count)
+	{
+		Head old = head.load(std::memory_order_relaxed);
+
+		do
+		{
+			link(links, last).store(top(old), std::memory_order_relaxed);
+		}
+		while (!head.compare_exchange_weak(old, pack(first, generation(old)),
+				std::memory_order_release, std::memory_order_relaxed));
+
+		this->count.fetch_add(count, std::memory_order_relaxed);
+	}
+
+	/**
+	 * \brief Push a free element.
+	 */
+	template<typename Links>
+	void push(const Links& links, Link index)
+	{
+		push(links, index, index, 1);
+	}
+
+	/**
+	 * \brief Pop a free element.
+	 *
+	 * \return The index of the element.
+	 * 		none when there are no free elements.
+	 */
+	template<typename Links>
+	Link pop(const Links& links)
+	{
+		Head old = head.load(std::memory_order_acquire);
+
+		while (top(old) != none
+				&& !head.compare_exchange_weak(old, pack(link(links, top(old)).load(std::memory_order_relaxed), generation(old) + 1),
+						std::memory_order_acquire, std::memory_order_acquire))
+		{
+		}
+
+		if (top(old) != none)
+		{
+			count.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		return top(old);
+	}
+
+	/**
+	 * \brief Pop up to count free elements at once.
+	 *
+	 * The popped elements stay linked from the returned index, in stack order.
+	 *
+	 * \param count in: The number of elements wanted.
+	 * 		out: The number of elements popped.
+	 * \return The index of the first popped element.
+	 * 		none when there are no free elements.
+	 */
+	template<typename Links>
+	Link pop(const Links& links, size_t& count)
+	{
+		Head old = head.load(std::memory_order_acquire);
+		size_t popped;
+		Link next;
+
+		do
+		{
+			popped = 0;
+			next = top(old);
+
+			// A concurrent pop can overwrite the links while walking, any garbage index stops the walk.
+			// The head has then changed, so the exchange fails and the walk is retried.
+			while (popped < count && links.valid(next))
+			{
+				next = link(links, next).load(std::memory_order_relaxed);
+				popped++;
+			}
+		}
+		while (popped > 0
+				&& !head.compare_exchange_weak(old, pack(next, generation(old) + 1),
+						std::memory_order_acquire, std::memory_order_acquire));
+
+		this->count.fetch_sub(popped, std::memory_order_relaxed);
+		count = popped;
+
+		return top(old);
+	}
+
+	/**
+	 * \brief Link element index to element next, to build a chain for push().
+	 */
+	template<typename Links>
+	static void chain(const Links& links, Link index, Link next)
+	{
+		link(links, index).store(next, std::memory_order_relaxed);
+	}
+
+	/**
+	 * \brief The element linked from element index, in a chain that is not shared.
+	 */
+	template<typename Links>
+	static Link next(const Links& links, Link index)
+	{
+		return link(links, index).load(std::memory_order_relaxed);
+	}
+
+	bool empty() const
+	{
+		return (top(head.load(std::memory_order_relaxed)) == none);
+	}
+
+	/**
+	 * \brief The number of free elements.
+	 *
+	 * Only a snapshot when elements are pushed or popped concurrently.
+	 */
+	size_t elements() const
+	{
+		return count.load(std::memory_order_relaxed);
+	}
+};
+
+/**
+ * \brief Access to the links stored in an array of free elements.
+ */
+template<typename Slot>
+struct Links
+{
+	Slot* slots;
+	Link limit;
+
+	bool valid(Link index) const
+	{
+		return (index < limit);
+	}
+
+	Link& operator()(Link index) const
+	{
+		return slots[index].next;
+	}
+};
+
+#ifdef ETL_POOL_DEBUG
+/**
+ * \brief One bit for each of Elements elements.
+ *
+ * Inline for a number of elements known at compile time (Elements > 0),
+ * on the heap for a number given at run time (Elements == 0).
+ */
+template<size_t Elements>
+struct Bitmap
+{
+	std::atomic<uint64_t> words[(Elements + 63) / 64] = {};
+
+	static constexpr size_t size = (Elements + 63) / 64;
+};
+
+template<>
+struct Bitmap<0>
+{
+	std::atomic<uint64_t>* words;
+	size_t size;
+
+	explicit Bitmap(size_t elements) :
+			words(new std::atomic<uint64_t>[(elements + 63) / 64]()),
+			size((elements + 63) / 64)
+	{
+	}
+
+	~Bitmap()
+	{
+		delete[] words;
+	}
+
+	Bitmap(const Bitmap&) = delete;
+	Bitmap& operator=(const Bitmap&) = delete;
+};
+#endif
+
+/**
+ * \brief The statistics (ETL_POOL_STATISTICS) and the taken elements (ETL_POOL_DEBUG) of a pool.
+ *
+ * Empty and without any cost when neither is defined.
+ */
+template<size_t Elements = 0>
+class Diagnostics
+{
+private:
+#ifdef ETL_POOL_STATISTICS
+	std::atomic<size_t> taken = 0;
+	std::atomic<size_t> released = 0;
+	std::atomic<size_t> inUse = 0;
+	std::atomic<size_t> peak = 0;
+	std::atomic<size_t> exhausted = 0;
+#endif
+#ifdef ETL_POOL_DEBUG
+	Bitmap<Elements> bitmap;
+#endif
+
+public:
+	constexpr Diagnostics() = default;
+
+	explicit Diagnostics([[maybe_unused]] size_t elements)
+#ifdef ETL_POOL_DEBUG
+			: bitmap(elements)
+#endif
+	{
+	}
+
+	/**
+	 * \brief Record that count of the wanted elements were taken.
+	 */
+	void recordTake([[maybe_unused]] size_t count, [[maybe_unused]] size_t wanted = 1)
+	{
+#ifdef ETL_POOL_STATISTICS
+		if (count > 0)
+		{
+			taken.fetch_add(count, std::memory_order_relaxed);
+
+			const size_t current = inUse.fetch_add(count, std::memory_order_relaxed) + count;
+			size_t highest = peak.load(std::memory_order_relaxed);
+
+			while (current > highest && !peak.compare_exchange_weak(highest, current, std::memory_order_relaxed))
+			{
+			}
+		}
+
+		if (count < wanted)
+		{
+			exhausted.fetch_add(1, std::memory_order_relaxed);
+		}
+#endif
+	}
+
+	/**
+	 * \brief Record that count elements were released.
+	 *
+	 * Called before the elements are pushed, so they are not counted in use twice once taken again.
+	 */
+	void recordRelease([[maybe_unused]] size_t count = 1)
+	{
+#ifdef ETL_POOL_STATISTICS
+		released.fetch_add(count, std::memory_order_relaxed);
+		inUse.fetch_sub(count, std::memory_order_relaxed);
+#endif
+	}
+
+	/**
+	 * \brief Mark element index taken, it must not be taken already.
+	 */
+	void markTaken([[maybe_unused]] size_t index)
+	{
+#ifdef ETL_POOL_DEBUG
+		const uint64_t bit = uint64_t(1) << (index % 64);
+		[[maybe_unused]] const uint64_t word = bitmap.words[index / 64].fetch_or(bit, std::memory_order_relaxed);
+
+		assert((word & bit) == 0);
+#endif
+	}
+
+	/**
+	 * \brief Mark element index released.
+	 *
+	 * \return The element was taken, always true without ETL_POOL_DEBUG.
+	 */
+	bool markReleased([[maybe_unused]] size_t index)
+	{
+		bool success = true;
+
+#ifdef ETL_POOL_DEBUG
+		const uint64_t bit = uint64_t(1) << (index % 64);
+
+		success = ((bitmap.words[index / 64].fetch_and(~bit, std::memory_order_relaxed) & bit) != 0);
+#endif
+
+		return success;
+	}
+
+#ifdef ETL_POOL_STATISTICS
+	PoolStatistics statistics() const
+	{
+		PoolStatistics statistics;
+
+		statistics.released = released.load(std::memory_order_relaxed);
+		statistics.taken = taken.load(std::memory_order_relaxed);
+		statistics.inUse = inUse.load(std::memory_order_relaxed);
+		statistics.peak = peak.load(std::memory_order_relaxed);
+		statistics.exhausted = exhausted.load(std::memory_order_relaxed);
+
+		return statistics;
+	}
+#endif
+
+#ifdef ETL_POOL_DEBUG
+	/**
+	 * \brief The number of taken elements.
+	 */
+	size_t leaked() const
+	{
+		size_t count = 0;
+
+		for (size_t i = 0; i < bitmap.size; i++)
+		{
+			count += std::popcount(bitmap.words[i].load(std::memory_order_relaxed));
+		}
+
+		return count;
+	}
+#endif
+};
+
+} // namespace detail
+
+/**
+ * \brief A pool of DataType elements.
+ *
+ * A pool can be used to effectively pass big data structures through connections between components.
+ * An element can be taken from the pool and passed around by reference.
+ * When taking an element the new owner is responsible to give it back to the pool at some point.
+ *
+ * A pool is thread safe in the sense that the take() and release() can be called concurrently,
+ * from any number of threads.
+ * The free elements are kept in a lock-free LIFO that is linked through the elements themselves,
+ * so the most recently released (cache-hot) element is taken first.
+ */
+template<typename DataType>
+class Pool
+{
+private:
+	typedef detail::Link Link;
+	typedef detail::FreeList FreeList;
+
+	union Slot
+	{
+		DataType data;
+		Link next;
+
+		Slot() {}
+		~Slot() {}
+	};
+
+	static constexpr Link none = FreeList::none;
+
+	size_t size;
+	Slot* slots;
+	FreeList available;
+	[[no_unique_address]] detail::Diagnostics<> diagnostics;
+
+	detail::Links<Slot> links() const
+	{
+		return detail::Links<Slot> { slots, static_cast<Link>(size) };
+	}
+
+	Link index(DataType& element) const
+	{
+		const Slot* slot = reinterpret_cast<const Slot*>(&element);
+
+		assert(slot >= slots && slot < &slots[size]);
+
+		return static_cast<Link>(slot - slots);
+	}
+
+public:
+	/**
+	 * \brief Create a heap.
+	 *
+	 * The array of DataType will be allocated on the heap.
+	 *
+	 * \param size The size of the pool in number of DataType.
+	 */
+	explicit Pool(size_t size) :
+			size(size),
+			slots(reinterpret_cast<Slot*>(malloc(size * sizeof(Slot)))),
+			diagnostics(size)
+	{
+		static_assert(alignof(Slot) <= alignof(max_align_t), "DataType is over-aligned for the heap.");
+
+		assert(size > 0 && size < none);
+
+		for (size_t i = 0; i < size - 1; i++)
+		{
+			FreeList::chain(links(), i, i + 1);
+		}
+
+		available.push(links(), 0, size - 1, size);
+	}
+
+	/**
+	 * \brief Destructor.
+	 *
+	 * Deallocates the array of DataType from the heap.
+	 */
+	~Pool()
+	{
+#ifdef ETL_POOL_DEBUG
+		assert(leaked() == 0);
+#endif
+
+		free(slots);
+	}
+
+	Pool(const Pool&) = delete;
+	Pool& operator=(const Pool&) = delete;
+
+	/**
+	 * \brief Is an element available in the pool?
+	 */
+	bool haveAvailable() const
+	{
+		return !available.empty();
+	}
+
+	/**
+	 * \brief Take an element from the pool.
+	 *
+	 * When an element is taken from the pool, the new "owner" is responsible
+	 * to release it back into the pool when it is no longer needed.
+	 *
+	 * \return Pointer to an element if the pool had one available.
+	 * 		nullptr if no element was available.
+	 */
+	DataType* take()
+	{
+		const Link index = available.pop(links());
+		DataType* element = nullptr;
+
+		diagnostics.recordTake(index != none);
+
+		if (index != none)
+		{
+			diagnostics.markTaken(index);
+			element = &slots[index].data;
+		}
+
+		return element;
+	}
+
+	/**
+	 * \brief Release an element into the pool.
+	 *
+	 * \param element The element to be released into the pool.
+	 * \return The element was successfully put in the pool.
+	 * 		When not successful the take-release mechanism was violated.
+	 */
+	bool release(DataType& element)
+	{
+		const bool success = (available.elements() < size) && diagnostics.markReleased(index(element));
+
+		if (success)
+		{
+			diagnostics.recordRelease();
+			available.push(links(), index(element));
+		}
+
+		return success;
+	}
+
+	/**
+	 * \brief Take a number of elements from the pool at once.
+	 *
+	 * The elements are taken with a single exchange on the pool, instead of one for every element.
+	 *
+	 * \param out Array of at least count element pointers.
+	 * \param count The number of elements wanted.
+	 * \return The number of elements taken and stored in out.
+	 */
+	size_t take(DataType** out, size_t count)
+	{
+		const size_t wanted = count;
+		Link index = available.pop(links(), count);
+
+		diagnostics.recordTake(count, wanted);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			diagnostics.markTaken(index);
+			out[i] = &slots[index].data;
+			index = FreeList::next(links(), index);
+		}
+
+		return count;
+	}
+
+	/**
+	 * \brief Release a number of elements into the pool at once.
+	 *
+	 * The elements are released with a single exchange on the pool, instead of one for every element.
+	 *
+	 * \param in Array of count element pointers.
+	 * \param count The number of elements to release.
+	 * \return The number of elements, from the start of in, that were put in the pool.
+	 * 		Less than count when the take-release mechanism was violated.
+	 */
+	size_t release(DataType* const* in, size_t count)
+	{
+		const size_t inPool = available.elements();
+
+		const size_t room = (inPool < size) ? std::min(count, size - inPool) : 0;
+
+		count = 0;
+
+		while (count < room && diagnostics.markReleased(index(*in[count])))
+		{
+			count++;
+		}
+
+		if (count > 0)
+		{
+			for (size_t i = 0; i < count - 1; i++)
+			{
+				FreeList::chain(links(), index(*in[i]), index(*in[i + 1]));
+			}
+
+			diagnostics.recordRelease(count);
+			available.push(links(), index(*in[0]), index(*in[count - 1]), count);
+		}
+
+		return count;
+	}
+
+#ifdef ETL_POOL_STATISTICS
+	/**
+	 * \brief Statistics of the pool since its creation.
+	 *
+	 * Can be called from any thread while the pool is in use.
+	 * Elements in a Cache count as in use.
+	 */
+	PoolStatistics statistics() const
+	{
+		return diagnostics.statistics();
+	}
+#endif
+
+#ifdef ETL_POOL_DEBUG
+	/**
+	 * \brief The number of elements taken and not released.
+	 */
+	size_t leaked() const
+	{
+		return diagnostics.leaked();
+	}
+#endif
+
+	/**
+	 * \brief Owner of an element taken from a pool.
+	 *
+	 * A handle releases its element back into the pool when it is destroyed,
+	 * so an element can not leak or be released twice.
+	 * A handle can be moved but not copied.
+	 */
+	class Handle
+	{
+	private:
+		Pool* pool;
+		DataType* element;
+
+	public:
+		/**
+		 * \brief Create an empty handle.
+		 */
+		Handle() :
+				pool(nullptr),
+				element(nullptr)
+		{
+		}
+
+		/**
+		 * \brief Take an element from the pool.
+		 *
+		 * The handle is empty when the pool had no element available.
+		 */
+		explicit Handle(Pool& pool) :
+				pool(&pool),
+				element(pool.take())
+		{
+		}
+
+		/**
+		 * \brief Adopt an element that was taken from the pool.
+		 */
+		Handle(Pool& pool, DataType* element) :
+				pool(&pool),
+				element(element)
+		{
+		}
+
+		Handle(Handle&& other) :
+				pool(other.pool),
+				element(std::exchange(other.element, nullptr))
+		{
+		}
+
+		Handle& operator=(Handle&& other)
+		{
+			if (this != &other)
+			{
+				reset();
+				pool = other.pool;
+				element = std::exchange(other.element, nullptr);
+			}
+
+			return *this;
+		}
+
+		Handle(const Handle&) = delete;
+		Handle& operator=(const Handle&) = delete;
+
+		~Handle()
+		{
+			reset();
+		}
+
+		/**
+		 * \brief Release the element back into the pool, leaving the handle empty.
+		 */
+		void reset()
+		{
+			if (element != nullptr)
+			{
+				[[maybe_unused]] const bool released = pool->release(*element);
+				assert(released);
+				element = nullptr;
+			}
+		}
+
+		/**
+		 * \brief Give up ownership of the element without releasing it.
+		 *
+		 * \return The element, the caller is responsible to release it.
+		 */
+		DataType* detach()
+		{
+			return std::exchange(element, nullptr);
+		}
+
+		DataType* get() const
+		{
+			return element;
+		}
+
+		DataType& operator*() const
+		{
+			return *element;
+		}
+
+		DataType* operator->() const
+		{
+			return element;
+		}
+
+		explicit operator bool() const
+		{
+			return (element != nullptr);
+		}
+	};
+
+	/**
+	 * \brief A per-thread magazine of elements in front of a pool.
+	 *
+	 * A cache keeps a small stack of elements for one thread, so taking and releasing
+	 * elements through the cache needs no atomic operations in the common case.
+	 * Only when the cache runs empty or overflows, a batch of elements is exchanged
+	 * with the pool at once.
+	 *
+	 * A cache is not thread safe, every thread uses its own cache.
+	 * Declare it thread_local or on the stack of the thread, so it is flushed back
+	 * into the pool when the thread exits.
+	 * The pool must outlive all of its caches.
+	 */
+	class Cache
+	{
+	private:
+		Pool& pool;
+		size_t batch;
+		Link top;
+		size_t count;
+
+	public:
+		/**
+		 * \brief Create a cache.
+		 *
+		 * \param pool The pool to take elements from and to release elements to.
+		 * \param batch The number of elements exchanged with the pool at once.
+		 * 		The cache holds at most twice this number of elements.
+		 */
+		explicit Cache(Pool& pool, size_t batch = 16) :
+				pool(pool),
+				batch(batch),
+				top(none),
+				count(0)
+		{
+			assert(batch > 0);
+		}
+
+		/**
+		 * \brief Destructor.
+		 *
+		 * Flushes the cached elements back into the pool.
+		 */
+		~Cache()
+		{
+			flush();
+		}
+
+		Cache(const Cache&) = delete;
+		Cache& operator=(const Cache&) = delete;
+
+		/**
+		 * \brief Take an element from the cache, or a batch from the pool when the cache is empty.
+		 *
+		 * \return Pointer to an element if the cache or the pool had one available.
+		 * 		nullptr if no element was available.
+		 */
+		DataType* take()
+		{
+			if (count == 0)
+			{
+				count = batch;
+				top = pool.available.pop(pool.links(), count);
+				pool.diagnostics.recordTake(count);
+			}
+
+			DataType* element = nullptr;
+
+			if (count > 0)
+			{
+				pool.diagnostics.markTaken(top);
+				element = &pool.slots[top].data;
+				top = FreeList::next(pool.links(), top);
+				count--;
+			}
+
+			return element;
+		}
+
+		/**
+		 * \brief Release an element into the cache, a batch goes to the pool when the cache overflows.
+		 *
+		 * \param element The element to be released, taken from the same pool.
+		 * \return The element was successfully put in the cache.
+		 * 		When not successful the take-release mechanism was violated.
+		 */
+		bool release(DataType& element)
+		{
+			const Link index = pool.index(element);
+			const bool success = pool.diagnostics.markReleased(index);
+
+			if (success)
+			{
+				FreeList::chain(pool.links(), index, top);
+				top = index;
+				count++;
+
+				if (count > 2 * batch)
+				{
+					give(batch);
+				}
+			}
+
+			return success;
+		}
+
+		/**
+		 * \brief Release all cached elements into the pool.
+		 */
+		void flush()
+		{
+			if (count > 0)
+			{
+				give(count);
+			}
+		}
+
+		/**
+		 * \brief The number of elements in the cache.
+		 */
+		size_t elements() const
+		{
+			return count;
+		}
+
+	private:
+		void give(size_t number)
+		{
+			Link last = top;
+
+			for (size_t i = 1; i < number; i++)
+			{
+				last = FreeList::next(pool.links(), last);
+			}
+
+			const Link rest = FreeList::next(pool.links(), last);
+
+			pool.diagnostics.recordRelease(number);
+			pool.available.push(pool.links(), top, last, number);
+			top = rest;
+			count -= number;
+		}
+	};
+};
+
+/**
+ * \brief A pool of N Type elements in inline storage.
+ *
+ * Unlike Pool, a static pool constructs and destructs its elements:
+ * emplace() constructs an element in a free slot and destroy() destructs it and releases the slot.
+ * The slots are aligned for Type and the pool can be constant initialized, e.g. as a constinit global,
+ * so it needs neither the heap nor start-up code.
+ * Slots that were never used are handed out in order, only released slots are linked in the free list.
+ *
+ * emplace() and destroy() can be called concurrently, from any number of threads.
+ * Elements that are still in use when the pool is destructed are not destructed.
+ *
+ * \tparam Padded Pad every slot to a cache line, to avoid false sharing between
+ * 		neighbouring elements owned by different threads.
+ */
+template<typename Type, size_t N, bool Padded = false>
+class StaticPool
+{
+private:
+	typedef detail::Link Link;
+	typedef detail::FreeList FreeList;
+
+	static_assert(N > 0 && N < FreeList::none, "N is out of range for the pool index.");
+
+	static constexpr size_t alignment = std::max({ Padded ? size_t(ETL_CACHE_LINE_SIZE) : size_t(1), alignof(Type), alignof(Link) });
+
+	union alignas(alignment) Slot
+	{
+		Type data;
+		Link next;
+
+		constexpr Slot() :
+				next()
+		{
+		}
+
+		~Slot() requires std::is_trivially_destructible_v<Type> = default;
+		constexpr ~Slot() {}
+	};
+
+	static constexpr Link none = FreeList::none;
+
+	Slot slots[N];
+	FreeList available;
+	std::atomic<Link> fresh;
+	[[no_unique_address]] detail::Diagnostics<N> diagnostics;
+
+	detail::Links<Slot> links()
+	{
+		return detail::Links<Slot> { slots, static_cast<Link>(N) };
+	}
+
+	Link index(Type* element) const
+	{
+		const Slot* slot = reinterpret_cast<const Slot*>(element);
+
+		assert(slot >= slots && slot < &slots[N]);
+
+		return static_cast<Link>(slot - slots);
+	}
+
+public:
+	constexpr StaticPool() :
+			fresh(0)
+	{
+	}
+
+#ifdef ETL_POOL_DEBUG
+	~StaticPool()
+	{
+		assert(leaked() == 0);
+	}
+#endif
+
+	StaticPool(const StaticPool&) = delete;
+	StaticPool& operator=(const StaticPool&) = delete;
+
+	/**
+	 * \brief Is a slot available in the pool?
+	 */
+	bool haveAvailable() const
+	{
+		return (!available.empty() || fresh.load(std::memory_order_relaxed) < N);
+	}
+
+	/**
+	 * \brief Construct an element in a free slot.
+	 *
+	 * The new "owner" is responsible to destroy the element when it is no longer needed.
+	 *
+	 * \param args The arguments for the constructor of Type.
+	 * \return Pointer to the constructed element if the pool had a slot available.
+	 * 		nullptr if no slot was available.
+	 */
+	template<typename... Args>
+	Type* emplace(Args&&... args)
+	{
+		Link index = available.pop(links());
+
+		if (index == none && fresh.load(std::memory_order_relaxed) < N)
+		{
+			// Concurrent callers can overshoot N, by at most the number of callers.
+			index = fresh.fetch_add(1, std::memory_order_relaxed);
+			index = (index < N) ? index : none;
+		}
+
+		Type* element = nullptr;
+
+		diagnostics.recordTake(index != none);
+
+		if (index != none)
+		{
+			diagnostics.markTaken(index);
+			element = new (&slots[index].data) Type(std::forward<Args>(args)...);
+		}
+
+		return element;
+	}
+
+	/**
+	 * \brief Destruct an element and release its slot into the pool.
+	 *
+	 * \param element The element, constructed by emplace() on this pool.
+	 * \return The element was successfully destructed and its slot put in the pool.
+	 * 		When not successful the take-release mechanism was violated,
+	 * 		the element is then left as it is.
+	 */
+	bool destroy(Type* element)
+	{
+		const Link slot = index(element);
+		const bool success = diagnostics.markReleased(slot);
+
+		if (success)
+		{
+			element->~Type();
+			diagnostics.recordRelease();
+			available.push(links(), slot);
+		}
+
+		return success;
+	}
+
+#ifdef ETL_POOL_STATISTICS
+	/**
+	 * \brief Statistics of the pool since its creation.
+	 *
+	 * Can be called from any thread while the pool is in use.
+	 */
+	PoolStatistics statistics() const
+	{
+		return diagnostics.statistics();
+	}
+#endif
+
+#ifdef ETL_POOL_DEBUG
+	/**
+	 * \brief The number of elements constructed and not destroyed.
+	 */
+	size_t leaked() const
+	{
+		return diagnostics.leaked();
+	}
+#endif
+};
+
+/**
+ * \brief Where the slabs of a SlabPool are allocated.
+ */
+enum class SlabMemory
+{
+	heap, ///< Allocated on the heap, trim() can not give slabs back.
+	mapped, ///< Mapped from the OS, trim() gives the memory of free slabs back.
+	hugePages, ///< Mapped from the OS in whole 2 MiB pages and advised to be backed by huge pages.
+};
+
+/**
+ * \brief A pool of DataType elements that grows by slabs of elements.
+ *
+ * A slab pool starts with a number of slabs and allocates a new slab when no element is available,
+ * up to a maximum number of slabs.
+ * trim() gives the memory of slabs with only free elements back to the OS,
+ * such a slab is used again before a new slab is allocated.
+ *
+ * Like Pool, take() and release() can be called concurrently, from any number of threads.
+ * Taking an element is O(1), apart from the first take after the pool ran out, which adds a slab.
+ * Slabs are only unmapped or freed when the pool is destructed,
+ * so trim() never invalidates memory that a concurrent take() may still read.
+ */
+template<typename DataType>
+class SlabPool
+{
+private:
+	typedef detail::Link Link;
+	typedef detail::FreeList FreeList;
+
+	union Slot
+	{
+		DataType data;
+		Link next;
+
+		Slot() {}
+		~Slot() {}
+	};
+
+	/**
+	 * \brief A slab starts with a header slot, that holds the number of the slab, followed by the elements.
+	 *
+	 * Slabs are aligned to their size rounded up to a power of two,
+	 * so the header of an element is found by masking its address.
+	 * A huge page slab is a whole number of huge pages, so it is also aligned to a huge page.
+	 */
+	struct Slab
+	{
+		std::atomic<Slot*> slots;
+		bool trimmed;
+	};
+
+	/**
+	 * \brief Access to the links stored in free elements, in any of the slabs.
+	 */
+	struct SlabLinks
+	{
+		const Slab* slabs;
+		unsigned shift;
+		Link limit;
+		Link slabElements;
+
+		/**
+		 * \brief Is index an element in one of the allocated slabs?
+		 *
+		 * Huge page slabs hold fewer elements than the in-slab part of an index can address,
+		 * the indices past the last element of a slab are not valid either.
+		 */
+		bool valid(Link index) const
+		{
+			return (index < limit) && ((index & ((Link(1) << shift) - 1)) < slabElements);
+		}
+
+		Link& operator()(Link index) const
+		{
+			return slabs[index >> shift].slots.load(std::memory_order_relaxed)[1 + (index & ((Link(1) << shift) - 1))].next;
+		}
+	};
+
+	static constexpr Link none = FreeList::none;
+	static constexpr size_t hugePageSize = size_t(2) << 20;
+
+	const SlabMemory memory;
+	const size_t bytes;
+	const size_t slabElements;
+	const unsigned shift; // Element indices hold the slab number above shift, the element in the slab below.
+	const size_t maxSlabs;
+	const size_t alignment;
+
+	Slab* slabs;
+	std::atomic<size_t> allocated;
+	std::atomic<size_t> capacity;
+	FreeList available;
+	std::mutex mutex;
+	[[no_unique_address]] detail::Diagnostics<> diagnostics;
+
+	SlabLinks links() const
+	{
+		return SlabLinks { slabs, shift, static_cast<Link>(allocated.load(std::memory_order_acquire) << shift),
+				static_cast<Link>(slabElements) };
+	}
+
+	DataType* element(Link index) const
+	{
+		return &slabs[index >> shift].slots.load(std::memory_order_relaxed)[1 + (index & ((Link(1) << shift) - 1))].data;
+	}
+
+	Link index(DataType& element) const
+	{
+		Slot* slot = reinterpret_cast<Slot*>(&element);
+		Slot* header = reinterpret_cast<Slot*>(reinterpret_cast<uintptr_t>(slot) & ~(alignment - 1));
+		const Link slab = header->next;
+
+		assert(slab < allocated.load(std::memory_order_relaxed) && slabs[slab].slots.load(std::memory_order_relaxed) == header);
+		assert(slot > header && static_cast<size_t>(slot - header) <= slabElements);
+
+		return static_cast<Link>((slab << shift) | (slot - header - 1));
+	}
+
+	static size_t pageSize()
+	{
+#if ETL_POOL_MMAP
+		return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+		return 1;
+#endif
+	}
+
+	/**
+	 * \brief The size of a slab of slabSize elements and its header, in whole pages or whole huge pages.
+	 */
+	static size_t slabBytes(size_t slabSize, SlabMemory memory)
+	{
+		const size_t page = (memory == SlabMemory::hugePages) ? hugePageSize : pageSize();
+
+		return ((slabSize + 1) * sizeof(Slot) + page - 1) / page * page;
+	}
+
+	Slot* allocate() const
+	{
+		void* slots = nullptr;
+
+#if ETL_POOL_MMAP
+		if (memory != SlabMemory::heap)
+		{
+			// Map more than needed and unmap the unaligned head and the tail.
+			uint8_t* region = static_cast<uint8_t*>(mmap(nullptr, bytes + alignment, PROT_READ | PROT_WRITE,
+					MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+
+			if (region != MAP_FAILED)
+			{
+				uint8_t* start = reinterpret_cast<uint8_t*>((reinterpret_cast<uintptr_t>(region) + alignment - 1) & ~(alignment - 1));
+				uint8_t* end = start + bytes;
+
+				if (start > region)
+				{
+					munmap(region, start - region);
+				}
+
+				munmap(end, region + bytes + alignment - end);
+
+#ifdef MADV_HUGEPAGE
+				if (memory == SlabMemory::hugePages)
+				{
+					madvise(start, bytes, MADV_HUGEPAGE);
+				}
+#endif
+
+				slots = start;
+			}
+		}
+		else
+#endif
+		{
+			slots = memalign(alignment, bytes);
+		}
+
+		return static_cast<Slot*>(slots);
+	}
+
+	void deallocate(Slot* slots) const
+	{
+#if ETL_POOL_MMAP
+		if (memory != SlabMemory::heap)
+		{
+			munmap(slots, bytes);
+		}
+		else
+#endif
+		{
+			free(slots);
+		}
+	}
+
+	/**
+	 * \brief Link all elements of a slab and push them on the free list.
+	 */
+	void activate(size_t slab)
+	{
+		const SlabLinks links = this->links();
+		const Link first = static_cast<Link>(slab << shift);
+		const Link last = static_cast<Link>(first + slabElements - 1);
+
+		slabs[slab].slots.load(std::memory_order_relaxed)[0].next = static_cast<Link>(slab);
+		slabs[slab].trimmed = false;
+
+		for (Link index = first; index < last; index++)
+		{
+			FreeList::chain(links, index, index + 1);
+		}
+
+		capacity.fetch_add(slabElements, std::memory_order_relaxed);
+		available.push(links, first, last, slabElements);
+	}
+
+	/**
+	 * \brief Add a slab to the free list, when it is still empty.
+	 *
+	 * \return The free list has elements, or might have by now.
+	 * 		false when the pool can not grow any further.
+	 */
+	bool grow()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		bool success = !available.empty();
+
+		if (!success)
+		{
+			const size_t count = allocated.load(std::memory_order_relaxed);
+			size_t slab = 0;
+
+			while (slab < count && !slabs[slab].trimmed)
+			{
+				slab++;
+			}
+
+			if (slab < count)
+			{
+				activate(slab);
+				success = true;
+			}
+			else if (count < maxSlabs)
+			{
+				Slot* slots = allocate();
+
+				if (slots != nullptr)
+				{
+					slabs[count].slots.store(slots, std::memory_order_relaxed);
+					allocated.store(count + 1, std::memory_order_release);
+					activate(count);
+					success = true;
+				}
+			}
+		}
+
+		return success;
+	}
+
+public:
+	/**
+	 * \brief Create a slab pool.
+	 *
+	 * \param slabSize The number of elements in a slab, rounded up to a power of two.
+	 * 		With huge pages, rounded up to fill the whole huge pages of the slab instead.
+	 * \param maxSlabs The maximum number of slabs.
+	 * \param initialSlabs The number of slabs allocated up front.
+	 * \param memory Where the slabs are allocated.
+	 */
+	SlabPool(size_t slabSize, size_t maxSlabs, size_t initialSlabs = 1, SlabMemory memory = SlabMemory::heap) :
+			memory(memory),
+			bytes(slabBytes(std::bit_ceil(slabSize), memory)),
+			slabElements((memory == SlabMemory::hugePages) ? bytes / sizeof(Slot) - 1 : std::bit_ceil(slabSize)),
+			shift(static_cast<unsigned>(std::countr_zero(std::bit_ceil(slabElements)))),
+			maxSlabs(maxSlabs),
+			alignment(std::max(std::bit_ceil(bytes), alignof(Slot))),
+			slabs(new Slab[maxSlabs]),
+			allocated(0),
+			capacity(0),
+			diagnostics(maxSlabs << shift)
+	{
+		assert(slabSize > 0 && maxSlabs > 0 && initialSlabs <= maxSlabs);
+		assert((maxSlabs << shift) < none);
+
+		for (size_t slab = 0; slab < maxSlabs; slab++)
+		{
+			slabs[slab].slots.store(nullptr, std::memory_order_relaxed);
+			slabs[slab].trimmed = false;
+		}
+
+		while (allocated.load(std::memory_order_relaxed) < initialSlabs && grow())
+		{
+		}
+	}
+
+	/**
+	 * \brief Destructor.
+	 *
+	 * Gives all slabs back.
+	 */
+	~SlabPool()
+	{
+#ifdef ETL_POOL_DEBUG
+		assert(leaked() == 0);
+#endif
+
+		for (size_t slab = 0; slab < allocated.load(std::memory_order_relaxed); slab++)
+		{
+			deallocate(slabs[slab].slots.load(std::memory_order_relaxed));
+		}
+
+		delete[] slabs;
+	}
+
+	SlabPool(const SlabPool&) = delete;
+	SlabPool& operator=(const SlabPool&) = delete;
+
+	/**
+	 * \brief Is an element available in the pool, without growing it?
+	 */
+	bool haveAvailable() const
+	{
+		return !available.empty();
+	}
+
+	/**
+	 * \brief Take an element from the pool, grow the pool when no element is available.
+	 *
+	 * \return Pointer to an element if the pool had one available or could grow.
+	 * 		nullptr if the pool has reached its maximum size and no element was available.
+	 */
+	DataType* take()
+	{
+		Link index = available.pop(links());
+
+		while (index == none && grow())
+		{
+			index = available.pop(links());
+		}
+
+		diagnostics.recordTake(index != none);
+
+		if (index != none)
+		{
+			diagnostics.markTaken(index);
+		}
+
+		return (index != none) ? element(index) : nullptr;
+	}
+
+	/**
+	 * \brief Release an element into the pool.
+	 *
+	 * \param element The element to be released into the pool.
+	 * \return The element was successfully put in the pool.
+	 * 		When not successful the take-release mechanism was violated.
+	 */
+	bool release(DataType& element)
+	{
+		const bool success = (available.elements() < capacity.load(std::memory_order_relaxed))
+				&& diagnostics.markReleased(index(element));
+
+		if (success)
+		{
+			diagnostics.recordRelease();
+			available.push(links(), index(element));
+		}
+
+		return success;
+	}
+
+	/**
+	 * \brief Give the memory of slabs that have only free elements back to the OS.
+	 *
+	 * Only slabs in mapped memory can be trimmed.
+	 * While trimming, the free elements are taken out of the pool, so concurrent takes wait for the trim.
+	 *
+	 * \return The number of slabs trimmed.
+	 */
+	size_t trim()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		size_t trimmed = 0;
+
+		if (ETL_POOL_MMAP && memory != SlabMemory::heap)
+		{
+			const SlabLinks links = this->links();
+			const size_t count = allocated.load(std::memory_order_relaxed);
+			size_t* counts = new size_t[count]();
+
+			size_t popped = std::numeric_limits<size_t>::max();
+			const Link first = available.pop(links, popped);
+			Link index = first;
+
+			for (size_t i = 0; i < popped; i++)
+			{
+				counts[index >> shift]++;
+				index = FreeList::next(links, index);
+			}
+
+			for (size_t slab = 0; slab < count; slab++)
+			{
+				if (!slabs[slab].trimmed && counts[slab] == slabElements)
+				{
+					slabs[slab].trimmed = true;
+					capacity.fetch_sub(slabElements, std::memory_order_relaxed);
+					trimmed++;
+				}
+			}
+
+			// Push the free elements of the slabs that are kept back, before the trimmed slabs lose their links.
+			Link head = none;
+			Link tail = none;
+			size_t kept = 0;
+			index = first;
+
+			for (size_t i = 0; i < popped; i++)
+			{
+				const Link next = FreeList::next(links, index);
+
+				if (!slabs[index >> shift].trimmed)
+				{
+					if (kept > 0)
+					{
+						FreeList::chain(links, tail, index);
+					}
+					else
+					{
+						head = index;
+					}
+
+					tail = index;
+					kept++;
+				}
+
+				index = next;
+			}
+
+			if (kept > 0)
+			{
+				available.push(links, head, tail, kept);
+			}
+
+#if ETL_POOL_MMAP
+			for (size_t slab = 0; slab < count; slab++)
+			{
+				if (slabs[slab].trimmed && counts[slab] == slabElements)
+				{
+					madvise(slabs[slab].slots.load(std::memory_order_relaxed), bytes, MADV_DONTNEED);
+				}
+			}
+#endif
+
+			delete[] counts;
+		}
+
+		return trimmed;
+	}
+
+	/**
+	 * \brief The number of elements in the slabs in use.
+	 */
+	size_t size() const
+	{
+		return capacity.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * \brief Is element one of the elements of the pool?
+	 *
+	 * Compares the slab the element would be in with every slab, so O(n) in the number of slabs.
+	 */
+	bool contains(const DataType& element) const
+	{
+		const uintptr_t header = reinterpret_cast<uintptr_t>(&element) & ~(alignment - 1);
+		const size_t count = allocated.load(std::memory_order_acquire);
+		bool found = false;
+
+		for (size_t slab = 0; slab < count && !found; slab++)
+		{
+			found = (reinterpret_cast<uintptr_t>(slabs[slab].slots.load(std::memory_order_relaxed)) == header);
+		}
+
+		return found;
+	}
+
+#ifdef ETL_POOL_STATISTICS
+	/**
+	 * \brief Statistics of the pool since its creation.
+	 *
+	 * Can be called from any thread while the pool is in use.
+	 * Exhausted counts the takes that found the pool at its maximum size.
+	 */
+	PoolStatistics statistics() const
+	{
+		return diagnostics.statistics();
+	}
+#endif
+
+#ifdef ETL_POOL_DEBUG
+	/**
+	 * \brief The number of elements taken and not released.
+	 */
+	size_t leaked() const
+	{
+		return diagnostics.leaked();
+	}
+#endif
+};
+
+/**
+ * \brief Shared owner of a DataType element in a pool.
+ *
+ * The reference count is stored next to the element in the pool,
+ * so sharing an element needs no allocation of a control block.
+ * The last owner releases the element back into the pool.
+ *
+ * Like with Pool, the DataType element is not constructed nor destructed by the pool.
+ * Copies of a PooledShared can be used and destroyed concurrently from different threads.
+ */
+template<typename DataType>
+class PooledShared
+{
+public:
+	/**
+	 * \brief An element with its reference count.
+	 */
+	struct Element
+	{
+		DataType data;
+		std::atomic<uint32_t> references;
+	};
+
+	/**
+	 * \brief The pool to take shared elements from.
+	 */
+	typedef etl::Pool<Element> Pool;
+
+private:
+	Pool* pool;
+	Element* element;
+
+	void drop()
+	{
+		if (element != nullptr && element->references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			[[maybe_unused]] const bool released = pool->release(*element);
+			assert(released);
+		}
+
+		element = nullptr;
+	}
+
+public:
+	/**
+	 * \brief Create an empty shared owner.
+	 */
+	PooledShared() :
+			pool(nullptr),
+			element(nullptr)
+	{
+	}
+
+	/**
+	 * \brief Take an element from the pool, with a reference count of one.
+	 *
+	 * The shared owner is empty when the pool had no element available.
+	 */
+	explicit PooledShared(Pool& pool) :
+			pool(&pool),
+			element(pool.take())
+	{
+		if (element != nullptr)
+		{
+			new (&element->references) std::atomic<uint32_t>(1);
+		}
+	}
+
+	PooledShared(const PooledShared& other) :
+			pool(other.pool),
+			element(other.element)
+	{
+		if (element != nullptr)
+		{
+			element->references.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	PooledShared(PooledShared&& other) :
+			pool(other.pool),
+			element(std::exchange(other.element, nullptr))
+	{
+	}
+
+	PooledShared& operator=(const PooledShared& other)
+	{
+		if (element != other.element)
+		{
+			PooledShared copy(other);
+			*this = std::move(copy);
+		}
+
+		return *this;
+	}
+
+	PooledShared& operator=(PooledShared&& other)
+	{
+		if (this != &other)
+		{
+			drop();
+			pool = other.pool;
+			element = std::exchange(other.element, nullptr);
+		}
+
+		return *this;
+	}
+
+	~PooledShared()
+	{
+		drop();
+	}
+
+	/**
+	 * \brief Drop this reference, leaving the shared owner empty.
+	 */
+	void reset()
+	{
+		drop();
+	}
+
+	/**
+	 * \brief The number of owners of the element.
+	 *
+	 * Only a snapshot when owners are copied or destroyed concurrently.
+	 */
+	uint32_t references() const
+	{
+		return (element != nullptr) ? element->references.load(std::memory_order_relaxed) : 0;
+	}
+
+	DataType* get() const
+	{
+		return (element != nullptr) ? &element->data : nullptr;
+	}
+
+	DataType& operator*() const
+	{
+		return element->data;
+	}
+
+	DataType* operator->() const
+	{
+		return &element->data;
+	}
+
+	explicit operator bool() const
+	{
+		return (element != nullptr);
+	}
+};
+
+} // namespace etl
+
+#endif // ETL_POOL_H_
@@ -0,0 +1,268 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Mathias Spiessens
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software, hardware and associated documentation files (the "Solution"), to deal
+ * in the Solution without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Solution, and to permit persons to whom the Solution is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Solution.
+ *
+ * THE SOLUTION IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOLUTION OR THE USE OR OTHER DEALINGS IN THE
+ * SOLUTION.
+ */
+
+#ifndef ETL_POOLRESOURCE_H_
+#define ETL_POOLRESOURCE_H_
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <memory_resource>
+#include <new>
+
+#include "pool.h"
+
+namespace etl
+{
+
+namespace detail
+{
+
+/**
+ * \brief A block of memory in a size class.
+ *
+ * The slabs of a SlabPool are aligned beyond the block size, so every block is aligned to its size.
+ */
+template<size_t Size>
+struct alignas(Size) Block
+{
+	unsigned char bytes[Size];
+};
+
+/**
+ * \brief The size classes from Size up to MaxSize, in powers of two, each backed by a SlabPool of blocks.
+ *
+ * When the pool of a class is exhausted, its blocks are borrowed from the upstream resource.
+ * Only while such blocks are out, a released block is looked up in the slabs of the pool.
+ */
+template<size_t Size, size_t MaxSize, bool End = (Size > MaxSize)>
+class SizeClasses
+{
+private:
+	SlabPool<Block<Size>> pool;
+	std::atomic<size_t> borrowed;
+	SizeClasses<Size * 2, MaxSize> larger;
+
+	static size_t slabSize(size_t slabBytes)
+	{
+		return std::max(slabBytes / Size, size_t(1));
+	}
+
+	static size_t maxSlabs(size_t slabBytes, size_t maxSlabs)
+	{
+		// Stay within the range of the pool index.
+		return std::min(maxSlabs, size_t(std::numeric_limits<Link>::max() - 1) / std::bit_ceil(slabSize(slabBytes)));
+	}
+
+public:
+	SizeClasses(size_t slabBytes, size_t maxSlabs, SlabMemory memory) :
+			pool(slabSize(slabBytes), SizeClasses::maxSlabs(slabBytes, maxSlabs), 0, memory),
+			borrowed(0),
+			larger(slabBytes, maxSlabs, memory)
+	{
+	}
+
+	void* take(size_t size, std::pmr::memory_resource* upstream)
+	{
+		void* block = nullptr;
+
+		if (size <= Size)
+		{
+			block = pool.take();
+
+			if (block == nullptr)
+			{
+				block = upstream->allocate(Size, Size);
+				borrowed.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+		else
+		{
+			block = larger.take(size, upstream);
+		}
+
+		return block;
+	}
+
+	void release(void* block, size_t size, std::pmr::memory_resource* upstream)
+	{
+		if (size <= Size)
+		{
+			Block<Size>& released = *static_cast<Block<Size>*>(block);
+
+			if (borrowed.load(std::memory_order_relaxed) > 0 && !pool.contains(released))
+			{
+				borrowed.fetch_sub(1, std::memory_order_relaxed);
+				upstream->deallocate(block, Size, Size);
+			}
+			else
+			{
+				[[maybe_unused]] const bool success = pool.release(released);
+				assert(success);
+			}
+		}
+		else
+		{
+			larger.release(block, size, upstream);
+		}
+	}
+
+	size_t trim()
+	{
+		return pool.trim() + larger.trim();
+	}
+};
+
+template<size_t Size, size_t MaxSize>
+class SizeClasses<Size, MaxSize, true>
+{
+public:
+	SizeClasses(size_t, size_t, SlabMemory)
+	{
+	}
+
+	void* take(size_t, std::pmr::memory_resource*)
+	{
+		return nullptr;
+	}
+
+	void release(void*, size_t, std::pmr::memory_resource*)
+	{
+	}
+
+	size_t trim()
+	{
+		return 0;
+	}
+};
+
+} // namespace detail
+
+/**
+ * \brief A memory resource that serves allocations from pools of power-of-two size classes.
+ *
+ * Allocations up to MaxSize bytes are rounded up to a size class, from MinSize bytes on,
+ * and taken from the SlabPool of that class. Larger allocations go to the upstream resource,
+ * as do allocations from a class that reached its maximum number of slabs.
+ * Like the pools, the resource can be used concurrently from any number of threads.
+ *
+ * Standard containers use the resource through a PoolAllocator, e.g. std::pmr::vector.
+ */
+template<size_t MinSize = 16, size_t MaxSize = 4096>
+class PoolResource : public std::pmr::memory_resource
+{
+public:
+	static_assert(std::has_single_bit(MinSize) && MinSize <= MaxSize, "The size classes are powers of two.");
+
+	static constexpr size_t minSize = MinSize;
+	static constexpr size_t maxSize = MaxSize;
+
+private:
+	detail::SizeClasses<MinSize, MaxSize> classes;
+	std::pmr::memory_resource* upstream;
+
+	static size_t sizeClass(size_t bytes, size_t alignment)
+	{
+		return std::max(bytes, alignment);
+	}
+
+protected:
+	void* do_allocate(size_t bytes, size_t alignment) override
+	{
+		void* memory;
+
+		if (sizeClass(bytes, alignment) <= maxSize)
+		{
+			memory = classes.take(sizeClass(bytes, alignment), upstream);
+		}
+		else
+		{
+			memory = upstream->allocate(bytes, alignment);
+		}
+
+		return memory;
+	}
+
+	void do_deallocate(void* memory, size_t bytes, size_t alignment) override
+	{
+		if (sizeClass(bytes, alignment) <= maxSize)
+		{
+			classes.release(memory, sizeClass(bytes, alignment), upstream);
+		}
+		else
+		{
+			upstream->deallocate(memory, bytes, alignment);
+		}
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+	{
+		return (this == &other);
+	}
+
+public:
+	/**
+	 * \brief Create a pool resource.
+	 *
+	 * \param slabBytes The size in bytes of a slab in every size class.
+	 * \param maxSlabs The maximum number of slabs in every size class.
+	 * \param memory Where the slabs are allocated.
+	 * \param upstream The resource for allocations larger than MaxSize, or from an exhausted size class.
+	 */
+	explicit PoolResource(size_t slabBytes = 64 * 1024, size_t maxSlabs = 1024, SlabMemory memory = SlabMemory::heap,
+			std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) :
+			classes(slabBytes, maxSlabs, memory),
+			upstream(upstream)
+	{
+	}
+
+	PoolResource(const PoolResource&) = delete;
+	PoolResource& operator=(const PoolResource&) = delete;
+
+	/**
+	 * \brief Give the memory of free slabs back to the OS, see SlabPool::trim().
+	 *
+	 * \return The number of slabs trimmed.
+	 */
+	size_t trim()
+	{
+		return classes.trim();
+	}
+
+	std::pmr::memory_resource* upstreamResource() const
+	{
+		return upstream;
+	}
+};
+
+/**
+ * \brief Allocator for standard containers, taking memory from a PoolResource.
+ */
+template<typename Type>
+using PoolAllocator = std::pmr::polymorphic_allocator<Type>;
+
+} // namespace etl
+
+#endif // ETL_POOLRESOURCE_H_
@@ -1,242 +1,1575 @@
-/* The MIT License (MIT)
- *
- * Copyright (c) 2021 Mathias Spiessens
- *
- * Permission is hereby granted, free of charge, to any person obtaining a copy
- * of this software, hardware and associated documentation files (the "Solution"), to deal
- * in the Solution without restriction, including without limitation the rights
- * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
- * copies of the Solution, and to permit persons to whom the Solution is
- * furnished to do so, subject to the following conditions:
- *
- * The above copyright notice and this permission notice shall be included in all
- * copies or substantial portions of the Solution.
- *
- * THE SOLUTION IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
- * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
- * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
- * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
- * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
- * OUT OF OR IN CONNECTION WITH THE SOLUTION OR THE USE OR OTHER DEALINGS IN THE
- * SOLUTION.
- */
-
-#ifndef ETL_QUEUE_H_
-#define ETL_QUEUE_H_
-
-#include <assert.h>
-#include <malloc.h>
-#include <string.h>
-
-#include <atomic>
-
-namespace etl
-{
-
-namespace // private
-{
-
-class GenericQueue
-{
-private:
-	const size_t elementSize;
-	const size_t elementCount;
-	uint8_t* data;
-	std::atomic<uint16_t> first = 0;
-	std::atomic<uint16_t> last = 0;
-	std::atomic<uint16_t> enqueued = 0;
-	std::atomic<uint16_t> dequeued = 0;
-
-protected:
-	/**
-	 * \brief Create a queue.
-	 *
-	 * The array of DataType will be allocated on the heap.
-	 *
-	 * \param size The size of the queue in number of DataType.
-	 */
-	explicit GenericQueue(size_t elementCount, size_t elementSize) :
-			elementCount(elementCount),
-			elementSize(elementSize)
-	{
-		assert(elementCount < UINT16_MAX);
-		data = reinterpret_cast<uint8_t*>(malloc(elementCount * elementSize));
-	}
-
-	/**
-	 * \brief Destructor.
-	 *
-	 * Deallocates the array of DataType from the heap.
-	 */
-	~GenericQueue()
-	{
-		free(data);
-	}
-
-	/**
-	 * \brief Enqueue an element of DataType.
-	 *
-	 * Can be called concurrently with respect to dequeue().
-	 * If the queue is full the given element is not added.
-	 *
-	 * \param element The element to be enqueued.
-	 * \return The element was successfully enqueued.
-	 */
-	bool enqueue(const void* element)
-	{
-		bool success = false;
-
-		if (!full())
-		{
-			memcpy(&data[last * elementSize], element, elementSize);
-
-			last = (last == size() - 1) ? 0 : last + 1;
-
-			enqueued++;
-
-			success = true;
-		}
-
-		return success;
-	}
-
-	/**
-	 * \brief Dequeue an element of DataType.
-	 *
-	 * Can be called concurrently with respect to enqueue().
-	 *
-	 * \param element [output] The dequeued element.
-	 * 		The return value indicates whether the element is valid.
-	 * \return An element was successfully dequeued.
-	 * 		Thus the element output parameter has a valid value.
-	 */
-	bool dequeue(void* element)
-	{
-		bool success = false;
-
-		if (!empty())
-		{
-			memcpy(element , &data[first * elementSize], elementSize);
-
-			first = (first == size() - 1) ? 0 : first + 1;
-
-			dequeued++;
-
-			success = true;
-		}
-
-		return success;
-	}
-
-	/**
-	 * \brief Peek in the queue.
-	 *
-	 * Does not modify the queue in any way.
-	 *
-	 * \param element [output] The next element to be dequeued.
-	 * 		The return value indicates whether the element is valid.
-	 * \return The queue is not empty.
-	 * 		Thus the element output parameter has a valid value.
-	 */
-	bool peek(void* element) const
-	{
-		bool success = false;
-
-		if (!empty())
-		{
-			memcpy(element , &data[first * elementSize], elementSize);
-
-			success = true;
-		}
-
-		return success;
-	}
-
-public:
-	bool empty() const
-	{
-		return (enqueued == dequeued);
-	}
-
-	bool full() const
-	{
-		return (enqueued == static_cast<uint16_t>(dequeued + size()));
-	}
-
-	bool peek() const
-	{
-		return !empty();
-	}
-
-	size_t elements() const
-	{
-		int32_t delta = static_cast<int32_t>(enqueued) - static_cast<int32_t>(dequeued);
-
-		return static_cast<size_t>((delta >= 0) ? delta : delta + UINT16_MAX + 1);
-	}
-
-	size_t size() const
-	{
-		return elementCount;
-	}
-};
-
-} // namespace // private
-
-template<typename Type>
-class Queue : 
-		public GenericQueue
-{
-public:
-	explicit Queue(size_t size) :
-			GenericQueue(size, sizeof(Type))
-	{
-	}
-
-	/**
-	 * \brief Enqueue an element of DataType.
-	 *
-	 * Can be called concurrently with respect to dequeue().
-	 * If the queue is full the given element is not added.
-	 *
-	 * \param element The element to be enqueued.
-	 * \return The element was successfully enqueued.
-	 */
-	bool enqueue(const Type& element)
-	{
-		return GenericQueue::enqueue(&element);
-	}
-	/**
-	 * \brief Dequeue an element of DataType.
-	 *
-	 * Can be called concurrently with respect to enqueue().
-	 *
-	 * \param element [output] The dequeued element.
-	 * 		The return value indicates whether the element is valid.
-	 * \return An element was successfully dequeued.
-	 * 		Thus the element output parameter has a valid value.
-	 */
-	bool dequeue(Type& element)
-	{
-		return GenericQueue::dequeue(&element);
-	}
-	
-	/**
-	 * \brief Peek in the queue.
-	 *
-	 * Does not modify the queue in any way.
-	 *
-	 * \param element [output] The next element to be dequeued.
-	 * 		The return value indicates whether the element is valid.
-	 * \return The queue is not empty.
-	 * 		Thus the element output parameter has a valid value.
-	 */
-	bool peek(Type& element) const
-	{
-		return GenericQueue::peek(&element);
-	}
-};
-
-} // namespace etl
-
-#endif // ETL_QUEUE_H_
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Mathias Spiessens
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software, hardware and associated documentation files (the "Solution"), to deal
+ * in the Solution without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Solution, and to permit persons to whom the Solution is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Solution.
+ *
+ * THE SOLUTION IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOLUTION OR THE USE OR OTHER DEALINGS IN THE
+ * SOLUTION.
+ */
+
+#ifndef ETL_QUEUE_H_
+#define ETL_QUEUE_H_
+
+#include <assert.h>
+#include <malloc.h>
+#include <string.h>
+
+#include <atomic>
+#include <bit>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#ifdef ETL_QUEUE_BLOCKING
+#include <chrono>
+#include <semaphore>
+#endif
+
+#ifndef ETL_CACHE_LINE_SIZE
+/**
+ * \brief Size in bytes of a data cache line on the target.
+ *
+ * Define as 1 on targets without a data cache to drop the padding.
+ */
+#define ETL_CACHE_LINE_SIZE 64
+#endif
+
+/**
+ * \def ETL_QUEUE_BLOCKING
+ * \brief Define to allow enqueueWait() and dequeueWait() on every Queue and StaticQueue.
+ * Adds the wait state of both sides to every queue,
+ * and a memory fence to every publication of elements or room.
+ *
+ * \def ETL_QUEUE_STATISTICS
+ * \brief Define to record statistics of every Queue and StaticQueue, see statistics().
+ *
+ * \def ETL_QUEUE_TIMESTAMP()
+ * \brief Define, next to ETL_QUEUE_STATISTICS, as an expression yielding the current time
+ * in ticks (uint32_t) to also record how long elements stay in the queue.
+ * E.g. a cycle counter on a microcontroller.
+ */
+
+namespace etl
+{
+
+#ifdef ETL_QUEUE_STATISTICS
+/**
+ * \brief Statistics of a queue.
+ */
+struct QueueStatistics
+{
+	size_t enqueued; // Number of elements enqueued since creation.
+	size_t dequeued; // Number of elements dequeued since creation.
+	size_t highWater; // Highest number of elements in the queue.
+	size_t full; // Number of enqueue calls that found the queue full.
+	size_t empty; // Number of dequeue calls that found the queue empty.
+#ifdef ETL_QUEUE_TIMESTAMP
+	// Histogram of the time elements stayed in the queue.
+	// Bucket 0 counts 0 ticks, bucket i counts [2^(i-1), 2^i) ticks.
+	uint32_t residency[33];
+#endif
+};
+#endif
+
+namespace detail
+{
+
+/**
+ * \brief A size known at compile time (Value > 0) or given at run time (Value == 0).
+ */
+template<size_t Value>
+struct Extent
+{
+	explicit Extent([[maybe_unused]] size_t value)
+	{
+		assert(value == Value);
+	}
+
+	operator size_t() const
+	{
+		return Value;
+	}
+};
+
+template<>
+struct Extent<0>
+{
+	const size_t value;
+
+	explicit Extent(size_t value) :
+			value(value)
+	{
+	}
+
+	operator size_t() const
+	{
+		return value;
+	}
+};
+
+/**
+ * \brief An array of bytes.
+ *
+ * Inline when the size is known at compile time (Size > 0),
+ * allocated on the heap when the size is given at run time (Size == 0).
+ */
+template<size_t Size, size_t Alignment>
+struct Storage
+{
+	alignas(Alignment) uint8_t data[Size];
+
+	explicit Storage([[maybe_unused]] size_t size)
+	{
+		assert(size == Size);
+	}
+};
+
+template<size_t Alignment>
+struct Storage<0, Alignment>
+{
+	uint8_t* const data;
+
+	explicit Storage(size_t size) :
+			data(reinterpret_cast<uint8_t*>(malloc(size)))
+	{
+	}
+
+	~Storage()
+	{
+		free(data);
+	}
+};
+
+/**
+ * \brief Single producer, single consumer ring buffer.
+ *
+ * The state written by the producer and the state written by the consumer
+ * live on separate cache lines, so they do not invalidate each other.
+ * Each side keeps a cached copy of the other side's counter and only reloads it
+ * when the queue looks full (producer) or empty (consumer).
+ *
+ * The counters have the width of Index, which limits the number of elements
+ * to one less than the maximum value of Index.
+ *
+ * The element size and count are either given at run time (0) or known at compile time.
+ * In the latter case the elements are stored inline and, for a power of two count,
+ * the indices wrap around with a mask instead of a compare and branch.
+ */
+template<typename Index = uint16_t, size_t ElementSize = 0, size_t ElementCount = 0, size_t Alignment = 1>
+class GenericQueue
+{
+private:
+	static_assert(std::is_unsigned_v<Index>, "Index must be an unsigned integer.");
+
+	static constexpr size_t lineSize = (ETL_CACHE_LINE_SIZE > alignof(std::atomic<Index>)) ?
+			ETL_CACHE_LINE_SIZE : alignof(std::atomic<Index>);
+
+	static constexpr bool masked = (ElementCount > 0) && ((ElementCount & (ElementCount - 1)) == 0);
+
+	[[no_unique_address]] const Extent<ElementSize> elementSize;
+	[[no_unique_address]] const Extent<ElementCount> elementCount;
+
+	Storage<ElementSize * ElementCount, Alignment> storage;
+
+#if defined(ETL_QUEUE_STATISTICS) && defined(ETL_QUEUE_TIMESTAMP)
+	Storage<ElementCount * sizeof(uint32_t), alignof(uint32_t)> stamps { elementCount * sizeof(uint32_t) };
+#endif
+
+	/**
+	 * \brief State owned by the producer.
+	 */
+	struct alignas(lineSize) Producer
+	{
+		Index last = 0;
+		std::atomic<Index> enqueued = 0;
+		Index dequeued = 0; // Cached copy of Consumer::dequeued.
+#ifdef ETL_QUEUE_STATISTICS
+		std::atomic<size_t> total = 0;
+		std::atomic<size_t> highWater = 0;
+		std::atomic<size_t> full = 0;
+#endif
+	} producer;
+
+	/**
+	 * \brief State owned by the consumer.
+	 */
+	struct alignas(lineSize) Consumer
+	{
+		Index first = 0;
+		std::atomic<Index> dequeued = 0;
+		mutable Index enqueued = 0; // Cached copy of Producer::enqueued.
+#ifdef ETL_QUEUE_STATISTICS
+		std::atomic<size_t> total = 0;
+		std::atomic<size_t> empty = 0;
+#ifdef ETL_QUEUE_TIMESTAMP
+		std::atomic<uint32_t> residency[33] = {};
+#endif
+#endif
+	} consumer;
+
+	static_assert(alignof(Producer) >= lineSize && alignof(Consumer) >= lineSize,
+			"The producer and consumer state must start on their own cache line.");
+
+#ifdef ETL_QUEUE_BLOCKING
+	/**
+	 * \brief A producer or consumer waiting for the other side.
+	 */
+	struct Sleeper
+	{
+		std::atomic<bool> waiting = false;
+		std::binary_semaphore wakeup { 0 };
+	};
+
+	/**
+	 * \brief State of blocking producer and consumer.
+	 */
+	struct alignas(lineSize) Sleepers
+	{
+		Sleeper producer;
+		Sleeper consumer;
+	} sleepers;
+#endif
+
+#ifdef ETL_QUEUE_STATISTICS
+	/**
+	 * \brief Add to a statistic only written by one side, lock-free readable by others.
+	 */
+	template<typename Counter>
+	static void add(std::atomic<Counter>& statistic, size_t count)
+	{
+		statistic.store(statistic.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+	}
+#endif
+
+	/**
+	 * \brief Move an index count elements forward, wrapping around the end of the queue.
+	 */
+	Index advance(Index index, size_t count) const
+	{
+		if constexpr (masked)
+		{
+			return (index + count) & (ElementCount - 1);
+		}
+		else
+		{
+			return (index + count < size()) ? index + count : index + count - size();
+		}
+	}
+
+	/**
+	 * \brief Number of free elements as seen by the producer.
+	 *
+	 * The consumer's counter is only reloaded when the cached copy
+	 * indicates less than the wanted number of free elements.
+	 */
+	size_t vacant(size_t wanted = 1)
+	{
+		const Index enqueued = producer.enqueued.load(std::memory_order_relaxed);
+
+		size_t vacant = size() - static_cast<Index>(enqueued - producer.dequeued);
+
+		if (vacant < wanted)
+		{
+			producer.dequeued = consumer.dequeued.load(std::memory_order_acquire);
+
+			vacant = size() - static_cast<Index>(enqueued - producer.dequeued);
+		}
+
+		return vacant;
+	}
+
+	/**
+	 * \brief Number of enqueued elements as seen by the consumer.
+	 *
+	 * The producer's counter is only reloaded when the cached copy
+	 * indicates less than the wanted number of elements.
+	 */
+	size_t occupied(size_t wanted = 1) const
+	{
+		const Index dequeued = consumer.dequeued.load(std::memory_order_relaxed);
+
+		size_t occupied = static_cast<Index>(consumer.enqueued - dequeued);
+
+		if (occupied < wanted)
+		{
+			consumer.enqueued = producer.enqueued.load(std::memory_order_acquire);
+
+			occupied = static_cast<Index>(consumer.enqueued - dequeued);
+		}
+
+		return occupied;
+	}
+
+#ifdef ETL_QUEUE_BLOCKING
+	/**
+	 * \brief Wake up the other side when it waits.
+	 *
+	 * Called after publishing a counter.
+	 * The other side only waits when the queue was full (producer) or empty (consumer),
+	 * so only those transitions signal the semaphore.
+	 */
+	void wake(Sleeper& sleeper)
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if (sleeper.waiting.load(std::memory_order_relaxed)
+				&& sleeper.waiting.exchange(false, std::memory_order_relaxed))
+		{
+			sleeper.wakeup.release();
+		}
+	}
+
+	/**
+	 * \brief Wait until the other side makes progress.
+	 *
+	 * \param ready Whether waiting is still needed, checked after announcing the wait.
+	 * \param deadline The time to give up waiting. nullptr to wait forever.
+	 * \return The other side made progress before the deadline.
+	 */
+	template<typename Ready>
+	bool sleep(Sleeper& sleeper, Ready ready, const std::chrono::steady_clock::time_point* deadline)
+	{
+		sleeper.waiting.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		bool progress = ready();
+		bool woken = false;
+
+		if (!progress)
+		{
+			if (deadline == nullptr)
+			{
+				sleeper.wakeup.acquire();
+				woken = true;
+			}
+			else
+			{
+				woken = sleeper.wakeup.try_acquire_until(*deadline);
+			}
+
+			progress = woken;
+		}
+
+		// Withdraw the wait, unless the other side already did so.
+		// Then its wakeup is in flight and has to be consumed.
+		if (!woken && !sleeper.waiting.exchange(false, std::memory_order_relaxed))
+		{
+			sleeper.wakeup.acquire();
+		}
+
+		return progress;
+	}
+#endif
+
+protected:
+	/**
+	 * \brief Create a queue.
+	 *
+	 * The array of DataType will be allocated on the heap,
+	 * unless its size is known at compile time.
+	 *
+	 * \param elementCount The size of the queue in number of DataType.
+	 * \param elementSize The size of DataType.
+	 */
+	explicit GenericQueue(size_t elementCount, size_t elementSize) :
+			elementSize(elementSize),
+			elementCount(elementCount),
+			storage(elementCount * elementSize)
+	{
+		assert(elementCount < std::numeric_limits<Index>::max());
+	}
+
+	/**
+	 * \brief Account for an enqueue that found the queue full.
+	 */
+	void noteFull()
+	{
+#ifdef ETL_QUEUE_STATISTICS
+		add(producer.full, 1);
+#endif
+	}
+
+	/**
+	 * \brief Account for a dequeue that found the queue empty.
+	 */
+	void noteEmpty()
+	{
+#ifdef ETL_QUEUE_STATISTICS
+		add(consumer.empty, 1);
+#endif
+	}
+
+	/**
+	 * \brief Enqueue an element of DataType.
+	 *
+	 * Can be called concurrently with respect to dequeue().
+	 * If the queue is full the given element is not added.
+	 *
+	 * \param element The element to be enqueued.
+	 * \return The element was successfully enqueued.
+	 */
+	bool enqueue(const void* element)
+	{
+		bool success = false;
+
+		if (vacant() > 0)
+		{
+			memcpy(&storage.data[producer.last * elementSize], element, elementSize);
+
+			commit(1);
+
+			success = true;
+		}
+		else
+		{
+			noteFull();
+		}
+
+		return success;
+	}
+
+	/**
+	 * \brief Dequeue an element of DataType.
+	 *
+	 * Can be called concurrently with respect to enqueue().
+	 *
+	 * \param element [output] The dequeued element.
+	 * 		The return value indicates whether the element is valid.
+	 * \return An element was successfully dequeued.
+	 * 		Thus the element output parameter has a valid value.
+	 */
+	bool dequeue(void* element)
+	{
+		bool success = false;
+
+		if (occupied() > 0)
+		{
+			memcpy(element, &storage.data[consumer.first * elementSize], elementSize);
+
+			release(1);
+
+			success = true;
+		}
+		else
+		{
+			noteEmpty();
+		}
+
+		return success;
+	}
+
+#ifdef ETL_QUEUE_BLOCKING
+	/**
+	 * \brief Enqueue, wait for room when the queue is full.
+	 *
+	 * \param enqueue Attempts to enqueue, returns whether it succeeded.
+	 * \param deadline The time to give up waiting. nullptr to wait forever.
+	 * \return The element was successfully enqueued.
+	 */
+	template<typename Enqueue>
+	bool enqueueWait(Enqueue enqueue, const std::chrono::steady_clock::time_point* deadline)
+	{
+		bool success = enqueue();
+
+		while (!success && sleep(sleepers.producer, [this]() { return (vacant() > 0); }, deadline))
+		{
+			success = enqueue();
+		}
+
+		return success;
+	}
+
+	/**
+	 * \brief Dequeue, wait for an element when the queue is empty.
+	 *
+	 * \param dequeue Attempts to dequeue, returns whether it succeeded.
+	 * \param deadline The time to give up waiting. nullptr to wait forever.
+	 * \return An element was successfully dequeued.
+	 */
+	template<typename Dequeue>
+	bool dequeueWait(Dequeue dequeue, const std::chrono::steady_clock::time_point* deadline)
+	{
+		bool success = dequeue();
+
+		while (!success && sleep(sleepers.consumer, [this]() { return (occupied() > 0); }, deadline))
+		{
+			success = dequeue();
+		}
+
+		return success;
+	}
+#endif
+
+	/**
+	 * \brief Enqueue a number of elements of DataType.
+	 *
+	 * Can be called concurrently with respect to dequeue().
+	 * The elements are copied in at most two chunks (before and after the wraparound)
+	 * and published to the consumer at once.
+	 *
+	 * \param elements The elements to be enqueued.
+	 * \param count The number of elements to be enqueued.
+	 * \return The number of elements that were enqueued.
+	 * 		Less than count when the queue became full.
+	 */
+	size_t enqueue(const void* elements, size_t count)
+	{
+		const size_t available = vacant(count);
+		const size_t enqueue = (count < available) ? count : available;
+
+		if (enqueue > 0)
+		{
+			const uint8_t* source = reinterpret_cast<const uint8_t*>(elements);
+
+			const size_t chunk = (enqueue < size() - producer.last) ? enqueue : size() - producer.last;
+
+			memcpy(&storage.data[producer.last * elementSize], source, chunk * elementSize);
+			memcpy(storage.data, &source[chunk * elementSize], (enqueue - chunk) * elementSize);
+
+			commit(enqueue);
+		}
+
+		if (enqueue < count)
+		{
+			noteFull();
+		}
+
+		return enqueue;
+	}
+
+	/**
+	 * \brief Dequeue a number of elements of DataType.
+	 *
+	 * Can be called concurrently with respect to enqueue().
+	 * The elements are copied out in at most two chunks (before and after the wraparound)
+	 * and released to the producer at once.
+	 *
+	 * \param elements [output] The dequeued elements.
+	 * \param count The maximum number of elements to be dequeued.
+	 * \return The number of elements that were dequeued.
+	 */
+	size_t dequeue(void* elements, size_t count)
+	{
+		const size_t available = occupied(count);
+		const size_t dequeue = (count < available) ? count : available;
+
+		if (dequeue > 0)
+		{
+			uint8_t* destination = reinterpret_cast<uint8_t*>(elements);
+
+			const size_t chunk = (dequeue < size() - consumer.first) ? dequeue : size() - consumer.first;
+
+			memcpy(destination, &storage.data[consumer.first * elementSize], chunk * elementSize);
+			memcpy(&destination[chunk * elementSize], storage.data, (dequeue - chunk) * elementSize);
+
+			release(dequeue);
+		}
+		else
+		{
+			noteEmpty();
+		}
+
+		return dequeue;
+	}
+
+	/**
+	 * \brief Peek in the queue.
+	 *
+	 * Does not modify the queue in any way.
+	 *
+	 * \param element [output] The next element to be dequeued.
+	 * 		The return value indicates whether the element is valid.
+	 * \return The queue is not empty.
+	 * 		Thus the element output parameter has a valid value.
+	 */
+	bool peek(void* element) const
+	{
+		const void* next = front();
+
+		if (next != nullptr)
+		{
+			memcpy(element, next, elementSize);
+		}
+
+		return (next != nullptr);
+	}
+
+	/**
+	 * \brief The next element of DataType to be dequeued.
+	 *
+	 * Does not modify the queue in any way.
+	 *
+	 * \return The next element to be dequeued.
+	 * 		nullptr when the queue is empty.
+	 */
+	const void* front() const
+	{
+		return (occupied() > 0) ? &storage.data[consumer.first * elementSize] : nullptr;
+	}
+
+	/**
+	 * \brief Reserve elements of DataType to be written in place.
+	 *
+	 * Can be called concurrently with respect to the consumer side.
+	 * The reserved elements are contiguous, so less than requested can be reserved
+	 * when the reservation would wrap around the end of the queue.
+	 * The elements become visible to the consumer with commit().
+	 *
+	 * \param count [input] The wanted number of elements.
+	 * 		[output] The number of elements that were reserved.
+	 * \return The first reserved element.
+	 * 		nullptr when the queue is full.
+	 */
+	void* reserve(size_t& count)
+	{
+		const size_t available = vacant(count);
+		const size_t contiguous = size() - producer.last;
+
+		count = (count < available) ? count : available;
+		count = (count < contiguous) ? count : contiguous;
+
+		return (count > 0) ? &storage.data[producer.last * elementSize] : nullptr;
+	}
+
+	/**
+	 * \brief Publish reserved elements of DataType to the consumer.
+	 *
+	 * \param count The number of elements to be published.
+	 * 		At most the number of elements returned by reserve().
+	 */
+	void commit(size_t count)
+	{
+		assert(count <= vacant(count));
+
+#if defined(ETL_QUEUE_STATISTICS) && defined(ETL_QUEUE_TIMESTAMP)
+		const uint32_t now = ETL_QUEUE_TIMESTAMP();
+		for (size_t i = 0; i < count; i++)
+		{
+			reinterpret_cast<uint32_t*>(stamps.data)[advance(producer.last, i)] = now;
+		}
+#endif
+
+		producer.last = advance(producer.last, count);
+
+		const Index enqueued = producer.enqueued.load(std::memory_order_relaxed) + count;
+		producer.enqueued.store(enqueued, std::memory_order_release);
+
+#ifdef ETL_QUEUE_BLOCKING
+		wake(sleepers.consumer);
+#endif
+
+#ifdef ETL_QUEUE_STATISTICS
+		add(producer.total, count);
+
+		const size_t occupancy = static_cast<Index>(enqueued - consumer.dequeued.load(std::memory_order_relaxed));
+		if (occupancy > producer.highWater.load(std::memory_order_relaxed))
+		{
+			producer.highWater.store(occupancy, std::memory_order_relaxed);
+		}
+#endif
+	}
+
+	/**
+	 * \brief Acquire enqueued elements of DataType to be read in place.
+	 *
+	 * Can be called concurrently with respect to the producer side.
+	 * The acquired elements are contiguous, so less than requested can be acquired
+	 * when the elements wrap around the end of the queue.
+	 * The elements are handed back to the producer with release().
+	 *
+	 * \param count [input] The wanted number of elements.
+	 * 		[output] The number of elements that were acquired.
+	 * \return The first acquired element.
+	 * 		nullptr when the queue is empty.
+	 */
+	void* acquire(size_t& count)
+	{
+		const size_t available = occupied(count);
+		const size_t contiguous = size() - consumer.first;
+
+		count = (count < available) ? count : available;
+		count = (count < contiguous) ? count : contiguous;
+
+		return (count > 0) ? &storage.data[consumer.first * elementSize] : nullptr;
+	}
+
+	/**
+	 * \brief Hand acquired elements of DataType back to the producer.
+	 *
+	 * \param count The number of elements to be released.
+	 * 		At most the number of elements returned by acquire().
+	 */
+	void release(size_t count)
+	{
+		assert(count <= occupied(count));
+
+#if defined(ETL_QUEUE_STATISTICS) && defined(ETL_QUEUE_TIMESTAMP)
+		const uint32_t now = ETL_QUEUE_TIMESTAMP();
+		for (size_t i = 0; i < count; i++)
+		{
+			const uint32_t ticks = now - reinterpret_cast<const uint32_t*>(stamps.data)[advance(consumer.first, i)];
+			add(consumer.residency[std::bit_width(ticks)], 1);
+		}
+#endif
+
+		consumer.first = advance(consumer.first, count);
+
+		consumer.dequeued.store(consumer.dequeued.load(std::memory_order_relaxed) + count, std::memory_order_release);
+
+#ifdef ETL_QUEUE_BLOCKING
+		wake(sleepers.producer);
+#endif
+
+#ifdef ETL_QUEUE_STATISTICS
+		add(consumer.total, count);
+#endif
+	}
+
+public:
+	bool empty() const
+	{
+		return (elements() == 0);
+	}
+
+	bool full() const
+	{
+		return (elements() == size());
+	}
+
+	bool peek() const
+	{
+		return !empty();
+	}
+
+	size_t elements() const
+	{
+		const Index dequeued = consumer.dequeued.load(std::memory_order_acquire);
+		const Index enqueued = producer.enqueued.load(std::memory_order_acquire);
+
+		return static_cast<Index>(enqueued - dequeued);
+	}
+
+	size_t size() const
+	{
+		return elementCount;
+	}
+
+#ifdef ETL_QUEUE_STATISTICS
+	/**
+	 * \brief Statistics of the queue since its creation.
+	 *
+	 * Can be called from any thread while the queue is in use.
+	 * The statistics are read one by one, so they are not a consistent snapshot.
+	 */
+	QueueStatistics statistics() const
+	{
+		QueueStatistics statistics;
+
+		statistics.enqueued = producer.total.load(std::memory_order_relaxed);
+		statistics.dequeued = consumer.total.load(std::memory_order_relaxed);
+		statistics.highWater = producer.highWater.load(std::memory_order_relaxed);
+		statistics.full = producer.full.load(std::memory_order_relaxed);
+		statistics.empty = consumer.empty.load(std::memory_order_relaxed);
+#ifdef ETL_QUEUE_TIMESTAMP
+		for (size_t i = 0; i < sizeof(statistics.residency) / sizeof(statistics.residency[0]); i++)
+		{
+			statistics.residency[i] = consumer.residency[i].load(std::memory_order_relaxed);
+		}
+#endif
+
+		return statistics;
+	}
+#endif
+};
+
+
+/**
+ * \brief The typed interface of a queue of Type on top of a GenericQueue.
+ *
+ * Trivially copyable types are copied in and out with memcpy.
+ * Other types are constructed in place in the queue, moved out and destroyed.
+ */
+template<typename Type, typename Base>
+class TypedQueue :
+		public Base
+{
+private:
+	static constexpr bool trivial = std::is_trivially_copyable_v<Type>;
+
+	/**
+	 * \brief Dequeue an element of a non trivially copyable Type.
+	 */
+	bool take(Type& element)
+	{
+		size_t count = 1;
+		Type* taken = reinterpret_cast<Type*>(Base::acquire(count));
+
+		if (taken != nullptr)
+		{
+			element = std::move(*taken);
+			taken->~Type();
+
+			Base::release(1);
+		}
+		else
+		{
+			Base::noteEmpty();
+		}
+
+		return (taken != nullptr);
+	}
+
+protected:
+	using Base::Base;
+
+	/**
+	 * \brief Destructor.
+	 *
+	 * Destroys the elements still in the queue.
+	 */
+	~TypedQueue()
+	{
+		if constexpr (!std::is_trivially_destructible_v<Type>)
+		{
+			size_t count = this->size();
+			Type* taken = reinterpret_cast<Type*>(Base::acquire(count));
+
+			while (taken != nullptr)
+			{
+				std::destroy_n(taken, count);
+				Base::release(count);
+
+				count = this->size();
+				taken = reinterpret_cast<Type*>(Base::acquire(count));
+			}
+		}
+	}
+
+public:
+	TypedQueue(const TypedQueue&) = delete;
+	TypedQueue& operator=(const TypedQueue&) = delete;
+
+	/**
+	 * \brief Enqueue an element of DataType.
+	 *
+	 * Can be called concurrently with respect to dequeue().
+	 * If the queue is full the given element is not added.
+	 *
+	 * \param element The element to be enqueued.
+	 * \return The element was successfully enqueued.
+	 */
+	bool enqueue(const Type& element)
+	{
+		if constexpr (trivial)
+		{
+			return Base::enqueue(&element);
+		}
+		else
+		{
+			return emplace(element);
+		}
+	}
+
+	/**
+	 * \brief Enqueue an element of DataType by moving it into the queue.
+	 *
+	 * Can be called concurrently with respect to dequeue().
+	 * If the queue is full the given element is not moved.
+	 *
+	 * \param element The element to be enqueued.
+	 * \return The element was successfully enqueued.
+	 */
+	bool enqueue(Type&& element)
+	{
+		if constexpr (trivial)
+		{
+			return Base::enqueue(&element);
+		}
+		else
+		{
+			return emplace(std::move(element));
+		}
+	}
+
+	/**
+	 * \brief Construct an element of DataType in place at the end of the queue.
+	 *
+	 * Can be called concurrently with respect to dequeue().
+	 * If the queue is full no element is constructed.
+	 *
+	 * \param args The arguments for the constructor of DataType.
+	 * \return The element was successfully enqueued.
+	 */
+	template<typename... Args>
+	bool emplace(Args&&... args)
+	{
+		size_t count = 1;
+		Type* reserved = reinterpret_cast<Type*>(Base::reserve(count));
+
+		if (reserved != nullptr)
+		{
+			new (reserved) Type(std::forward<Args>(args)...);
+
+			Base::commit(1);
+		}
+		else
+		{
+			Base::noteFull();
+		}
+
+		return (reserved != nullptr);
+	}
+
+	/**
+	 * \brief Dequeue an element of DataType.
+	 *
+	 * Can be called concurrently with respect to enqueue().
+	 * The element is moved out of the queue.
+	 *
+	 * \param element [output] The dequeued element.
+	 * 		The return value indicates whether the element is valid.
+	 * \return An element was successfully dequeued.
+	 * 		Thus the element output parameter has a valid value.
+	 */
+	bool dequeue(Type& element)
+	{
+		if constexpr (trivial)
+		{
+			return Base::dequeue(&element);
+		}
+		else
+		{
+			return take(element);
+		}
+	}
+
+#ifdef ETL_QUEUE_BLOCKING
+	/**
+	 * \brief Enqueue an element, wait for room when the queue is full.
+	 *
+	 * Can be called concurrently with respect to dequeue().
+	 *
+	 * \param element The element to be enqueued.
+	 */
+	void enqueueWait(const Type& element)
+	{
+		Base::enqueueWait([this, &element]() { return enqueue(element); }, nullptr);
+	}
+
+	/**
+	 * \brief Enqueue an element, wait for room when the queue is full.
+	 *
+	 * Can be called concurrently with respect to dequeue().
+	 *
+	 * \param element The element to be enqueued.
+	 * \param timeout The maximum time to wait.
+	 * \return The element was successfully enqueued before the timeout.
+	 */
+	template<typename Rep, typename Period>
+	bool enqueueWait(const Type& element, const std::chrono::duration<Rep, Period>& timeout)
+	{
+		const auto deadline = std::chrono::steady_clock::now()
+				+ std::chrono::ceil<std::chrono::steady_clock::duration>(timeout);
+
+		return Base::enqueueWait([this, &element]() { return enqueue(element); }, &deadline);
+	}
+
+	/**
+	 * \brief Enqueue an element by moving it into the queue, wait for room when the queue is full.
+	 *
+	 * Can be called concurrently with respect to dequeue().
+	 *
+	 * \param element The element to be enqueued.
+	 */
+	void enqueueWait(Type&& element)
+	{
+		Base::enqueueWait([this, &element]() { return enqueue(std::move(element)); }, nullptr);
+	}
+
+	/**
+	 * \brief Enqueue an element by moving it into the queue, wait for room when the queue is full.
+	 *
+	 * Can be called concurrently with respect to dequeue().
+	 *
+	 * \param element The element to be enqueued.
+	 * 		Not moved when the timeout expires.
+	 * \param timeout The maximum time to wait.
+	 * \return The element was successfully enqueued before the timeout.
+	 */
+	template<typename Rep, typename Period>
+	bool enqueueWait(Type&& element, const std::chrono::duration<Rep, Period>& timeout)
+	{
+		const auto deadline = std::chrono::steady_clock::now()
+				+ std::chrono::ceil<std::chrono::steady_clock::duration>(timeout);
+
+		return Base::enqueueWait([this, &element]() { return enqueue(std::move(element)); }, &deadline);
+	}
+
+	/**
+	 * \brief Dequeue an element, wait for one when the queue is empty.
+	 *
+	 * Can be called concurrently with respect to enqueue().
+	 *
+	 * \param element [output] The dequeued element.
+	 */
+	void dequeueWait(Type& element)
+	{
+		Base::dequeueWait([this, &element]() { return dequeue(element); }, nullptr);
+	}
+
+	/**
+	 * \brief Dequeue an element, wait for one when the queue is empty.
+	 *
+	 * Can be called concurrently with respect to enqueue().
+	 *
+	 * \param element [output] The dequeued element.
+	 * 		The return value indicates whether the element is valid.
+	 * \param timeout The maximum time to wait.
+	 * \return An element was successfully dequeued before the timeout.
+	 * 		Thus the element output parameter has a valid value.
+	 */
+	template<typename Rep, typename Period>
+	bool dequeueWait(Type& element, const std::chrono::duration<Rep, Period>& timeout)
+	{
+		const auto deadline = std::chrono::steady_clock::now()
+				+ std::chrono::ceil<std::chrono::steady_clock::duration>(timeout);
+
+		return Base::dequeueWait([this, &element]() { return dequeue(element); }, &deadline);
+	}
+#endif
+
+	/**
+	 * \brief Enqueue a number of elements of DataType.
+	 *
+	 * Can be called concurrently with respect to dequeue().
+	 * As many elements as there is room for are enqueued.
+	 *
+	 * \param elements The elements to be enqueued.
+	 * \param count The number of elements to be enqueued.
+	 * \return The number of elements that were enqueued.
+	 */
+	size_t enqueue(const Type* elements, size_t count)
+	{
+		size_t enqueued = 0;
+
+		if constexpr (trivial)
+		{
+			enqueued = Base::enqueue(elements, count);
+		}
+		else
+		{
+			size_t reserved = count;
+			Type* slots = reinterpret_cast<Type*>(Base::reserve(reserved));
+
+			while (slots != nullptr)
+			{
+				std::uninitialized_copy_n(&elements[enqueued], reserved, slots);
+				Base::commit(reserved);
+				enqueued += reserved;
+
+				reserved = count - enqueued;
+				slots = (reserved > 0) ? reinterpret_cast<Type*>(Base::reserve(reserved)) : nullptr;
+			}
+
+			if (enqueued < count)
+			{
+				Base::noteFull();
+			}
+		}
+
+		return enqueued;
+	}
+
+	/**
+	 * \brief Dequeue a number of elements of DataType.
+	 *
+	 * Can be called concurrently with respect to enqueue().
+	 *
+	 * \param elements [output] The dequeued elements.
+	 * \param count The maximum number of elements to be dequeued.
+	 * \return The number of elements that were dequeued.
+	 */
+	size_t dequeue(Type* elements, size_t count)
+	{
+		size_t dequeued = 0;
+
+		if constexpr (trivial)
+		{
+			dequeued = Base::dequeue(elements, count);
+		}
+		else
+		{
+			size_t acquired = count;
+			Type* slots = reinterpret_cast<Type*>(Base::acquire(acquired));
+
+			while (slots != nullptr)
+			{
+				std::move(slots, &slots[acquired], &elements[dequeued]);
+				std::destroy_n(slots, acquired);
+				Base::release(acquired);
+				dequeued += acquired;
+
+				acquired = count - dequeued;
+				slots = (acquired > 0) ? reinterpret_cast<Type*>(Base::acquire(acquired)) : nullptr;
+			}
+
+			if (dequeued == 0)
+			{
+				Base::noteEmpty();
+			}
+		}
+
+		return dequeued;
+	}
+
+	/**
+	 * \brief Dequeue all elements in the queue.
+	 *
+	 * Can be called concurrently with respect to enqueue().
+	 *
+	 * \param elements [output] The dequeued elements.
+	 * 		Must have room for size() elements.
+	 * \return The number of elements that were dequeued.
+	 */
+	size_t drain(Type* elements)
+	{
+		return dequeue(elements, this->size());
+	}
+
+	/**
+	 * \brief Peek in the queue.
+	 *
+	 * Does not modify the queue in any way.
+	 *
+	 * \param element [output] A copy of the next element to be dequeued.
+	 * 		The return value indicates whether the element is valid.
+	 * \return The queue is not empty.
+	 * 		Thus the element output parameter has a valid value.
+	 */
+	bool peek(Type& element) const
+	{
+		const Type* next = reinterpret_cast<const Type*>(Base::front());
+
+		if (next != nullptr)
+		{
+			element = *next;
+		}
+
+		return (next != nullptr);
+	}
+
+	/**
+	 * \brief Reserve elements to be written in place.
+	 *
+	 * Only for trivially copyable types.
+	 * Can be called concurrently with respect to the consumer side.
+	 * Less than requested can be reserved when the reservation would wrap
+	 * around the end of the queue.
+	 * The elements become visible to the consumer with commit().
+	 *
+	 * \param count [input] The wanted number of elements.
+	 * 		[output] The number of elements that were reserved.
+	 * \return The first reserved element.
+	 * 		nullptr when the queue is full.
+	 */
+	Type* reserve(size_t& count) requires trivial
+	{
+		Type* reserved = reinterpret_cast<Type*>(Base::reserve(count));
+
+		if (reserved == nullptr)
+		{
+			Base::noteFull();
+		}
+
+		return reserved;
+	}
+
+	/**
+	 * \brief Publish reserved elements to the consumer.
+	 *
+	 * \param count The number of elements to be published.
+	 */
+	void commit(size_t count) requires trivial
+	{
+		Base::commit(count);
+	}
+
+	/**
+	 * \brief Acquire enqueued elements to be read in place.
+	 *
+	 * Only for trivially copyable types.
+	 * Can be called concurrently with respect to the producer side.
+	 * Less than requested can be acquired when the elements wrap
+	 * around the end of the queue.
+	 * The elements are handed back to the producer with release().
+	 *
+	 * \param count [input] The wanted number of elements.
+	 * 		[output] The number of elements that were acquired.
+	 * \return The first acquired element.
+	 * 		nullptr when the queue is empty.
+	 */
+	Type* acquire(size_t& count) requires trivial
+	{
+		Type* acquired = reinterpret_cast<Type*>(Base::acquire(count));
+
+		if (acquired == nullptr)
+		{
+			Base::noteEmpty();
+		}
+
+		return acquired;
+	}
+
+	/**
+	 * \brief Hand acquired elements back to the producer.
+	 *
+	 * \param count The number of elements to be released.
+	 */
+	void release(size_t count) requires trivial
+	{
+		Base::release(count);
+	}
+};
+
+/**
+ * \brief The narrowest counter, at least 16 bit wide, for a queue of N elements.
+ */
+template<size_t N>
+using IndexFor = std::conditional_t<(N < UINT16_MAX), uint16_t,
+		std::conditional_t<(N < UINT32_MAX), uint32_t, uint64_t>>;
+
+} // namespace detail
+
+/**
+ * \brief A queue of Type, allocated on the heap.
+ *
+ * The size is limited to one less than the maximum value of Index:
+ * use uint32_t or uint64_t for queues of more than 65534 elements.
+ */
+template<typename Type, typename Index = uint16_t>
+class Queue :
+		public detail::TypedQueue<Type, detail::GenericQueue<Index>>
+{
+public:
+	/**
+	 * \param size The size of the queue in number of Type.
+	 */
+	explicit Queue(size_t size) :
+			detail::TypedQueue<Type, detail::GenericQueue<Index>>(size, sizeof(Type))
+	{
+		static_assert(alignof(Type) <= alignof(max_align_t), "Type is over-aligned for the heap.");
+	}
+};
+
+/**
+ * \brief A queue of N elements of Type, stored inline.
+ *
+ * Does not allocate, so it can live in static storage or on the stack.
+ * Use a power of two for N to wrap the indices around with a mask.
+ * The counters are 16 bit wide, unless N needs wider ones.
+ */
+template<typename Type, size_t N, typename Index = detail::IndexFor<N>>
+class StaticQueue :
+		public detail::TypedQueue<Type, detail::GenericQueue<Index, sizeof(Type), N, alignof(Type)>>
+{
+	static_assert(N > 0 && N < std::numeric_limits<Index>::max(), "Queue size out of range.");
+
+public:
+	StaticQueue() :
+			detail::TypedQueue<Type, detail::GenericQueue<Index, sizeof(Type), N, alignof(Type)>>(N, sizeof(Type))
+	{
+	}
+};
+
+/**
+ * \brief A queue of Type for multiple producers and multiple consumers.
+ *
+ * Lock-free, bounded queue after Dmitry Vyukov.
+ * Every element carries a sequence number that tells producers and consumers
+ * whether it is free or holds an element for the current round of the ring.
+ * Producers and consumers only contend on their own position counter.
+ *
+ * The array of elements will be allocated on the heap.
+ */
+template<typename Type>
+class MpmcQueue
+{
+private:
+	static constexpr size_t lineSize = (ETL_CACHE_LINE_SIZE > alignof(std::atomic<size_t>)) ?
+			ETL_CACHE_LINE_SIZE : alignof(std::atomic<size_t>);
+
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		alignas(Type) uint8_t element[sizeof(Type)];
+	};
+
+	const size_t mask;
+	Cell* const cells;
+
+	alignas(lineSize) std::atomic<size_t> enqueued = 0;
+	alignas(lineSize) std::atomic<size_t> dequeued = 0;
+
+	/**
+	 * \brief Claim the cell for the next element to be enqueued.
+	 *
+	 * \return The claimed cell, its sequence number is position.
+	 * 		nullptr when the queue is full.
+	 */
+	Cell* claimEnqueue(size_t& position)
+	{
+		Cell* claimed = nullptr;
+
+		position = enqueued.load(std::memory_order_relaxed);
+
+		while (claimed == nullptr)
+		{
+			Cell& cell = cells[position & mask];
+			const intptr_t difference = static_cast<intptr_t>(cell.sequence.load(std::memory_order_acquire) - position);
+
+			if (difference == 0)
+			{
+				if (enqueued.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				{
+					claimed = &cell;
+				}
+			}
+			else if (difference < 0)
+			{
+				break; // The cell still holds an element of the previous round: full.
+			}
+			else
+			{
+				position = enqueued.load(std::memory_order_relaxed);
+			}
+		}
+
+		return claimed;
+	}
+
+	/**
+	 * \brief Claim the cell holding the next element to be dequeued.
+	 *
+	 * \return The claimed cell, its sequence number is position + 1.
+	 * 		nullptr when the queue is empty.
+	 */
+	Cell* claimDequeue(size_t& position)
+	{
+		Cell* claimed = nullptr;
+
+		position = dequeued.load(std::memory_order_relaxed);
+
+		while (claimed == nullptr)
+		{
+			Cell& cell = cells[position & mask];
+			const intptr_t difference = static_cast<intptr_t>(cell.sequence.load(std::memory_order_acquire) - (position + 1));
+
+			if (difference == 0)
+			{
+				if (dequeued.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				{
+					claimed = &cell;
+				}
+			}
+			else if (difference < 0)
+			{
+				break; // The cell was not written for this round yet: empty.
+			}
+			else
+			{
+				position = dequeued.load(std::memory_order_relaxed);
+			}
+		}
+
+		return claimed;
+	}
+
+public:
+	/**
+	 * \brief Create a queue.
+	 *
+	 * \param size The size of the queue in number of Type, a power of two of at least 2.
+	 * 		With a single cell, the sequence number of a full cell equals that of the next free one.
+	 */
+	explicit MpmcQueue(size_t size) :
+			mask(size - 1),
+			cells(reinterpret_cast<Cell*>(malloc(size * sizeof(Cell))))
+	{
+		static_assert(alignof(Cell) <= alignof(max_align_t), "Type is over-aligned for the heap.");
+
+		assert(size >= 2 && (size & (size - 1)) == 0);
+
+		for (size_t i = 0; i < size; i++)
+		{
+			new (&cells[i].sequence) std::atomic<size_t>(i);
+		}
+	}
+
+	/**
+	 * \brief Destructor.
+	 *
+	 * Destroys the elements still in the queue
+	 * and deallocates the array of Type from the heap.
+	 */
+	~MpmcQueue()
+	{
+		if constexpr (!std::is_trivially_destructible_v<Type>)
+		{
+			const size_t enqueued = this->enqueued.load(std::memory_order_acquire);
+
+			for (size_t position = dequeued.load(std::memory_order_acquire); position != enqueued; position++)
+			{
+				std::launder(reinterpret_cast<Type*>(cells[position & mask].element))->~Type();
+			}
+		}
+
+		free(cells);
+	}
+
+	MpmcQueue(const MpmcQueue&) = delete;
+	MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+	/**
+	 * \brief Enqueue an element of Type.
+	 *
+	 * Can be called concurrently from any number of threads.
+	 * If the queue is full the given element is not added.
+	 *
+	 * \param element The element to be enqueued.
+	 * \return The element was successfully enqueued.
+	 */
+	bool enqueue(const Type& element)
+	{
+		size_t position;
+		Cell* cell = claimEnqueue(position);
+
+		if (cell != nullptr)
+		{
+			new (cell->element) Type(element);
+
+			cell->sequence.store(position + 1, std::memory_order_release);
+		}
+
+		return (cell != nullptr);
+	}
+
+	/**
+	 * \brief Dequeue an element of Type.
+	 *
+	 * Can be called concurrently from any number of threads.
+	 *
+	 * \param element [output] The dequeued element.
+	 * 		The return value indicates whether the element is valid.
+	 * \return An element was successfully dequeued.
+	 * 		Thus the element output parameter has a valid value.
+	 */
+	bool dequeue(Type& element)
+	{
+		size_t position;
+		Cell* cell = claimDequeue(position);
+
+		if (cell != nullptr)
+		{
+			Type* stored = std::launder(reinterpret_cast<Type*>(cell->element));
+			element = std::move(*stored);
+			stored->~Type();
+
+			cell->sequence.store(position + mask + 1, std::memory_order_release);
+		}
+
+		return (cell != nullptr);
+	}
+
+	/**
+	 * \brief Peek in the queue.
+	 *
+	 * Does not modify the queue in any way.
+	 * The copy is only reported valid when the element was not dequeued
+	 * by another consumer while copying, hence Type must be trivially copyable.
+	 *
+	 * \param element [output] The next element to be dequeued.
+	 * 		The return value indicates whether the element is valid.
+	 * \return The queue is not empty.
+	 * 		Thus the element output parameter has a valid value.
+	 */
+	bool peek(Type& element) const requires std::is_trivially_copyable_v<Type>
+	{
+		bool success = false;
+		bool retry = true;
+
+		while (retry)
+		{
+			const size_t position = dequeued.load(std::memory_order_acquire);
+			const Cell& cell = cells[position & mask];
+
+			retry = false;
+
+			if (cell.sequence.load(std::memory_order_acquire) == position + 1)
+			{
+				memcpy(&element, cell.element, sizeof(Type));
+
+				std::atomic_thread_fence(std::memory_order_acquire);
+
+				success = (cell.sequence.load(std::memory_order_relaxed) == position + 1);
+				retry = !success;
+			}
+		}
+
+		return success;
+	}
+
+	bool empty() const
+	{
+		return (elements() == 0);
+	}
+
+	bool full() const
+	{
+		return (elements() == size());
+	}
+
+	bool peek() const
+	{
+		return !empty();
+	}
+
+	/**
+	 * \brief The number of elements in the queue.
+	 *
+	 * Only a snapshot when producers or consumers are active.
+	 */
+	size_t elements() const
+	{
+		const size_t dequeued = this->dequeued.load(std::memory_order_acquire);
+		const size_t enqueued = this->enqueued.load(std::memory_order_acquire);
+
+		const intptr_t elements = static_cast<intptr_t>(enqueued - dequeued);
+
+		return (elements < 0) ? 0 : (static_cast<size_t>(elements) > size()) ? size() : static_cast<size_t>(elements);
+	}
+
+	size_t size() const
+	{
+		return mask + 1;
+	}
+};
+
+} // namespace etl
+
+#endif // ETL_QUEUE_H_
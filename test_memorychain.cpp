@@ -2,10 +2,25 @@
 #include <stddef.h>
 #include <string.h>
 
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <ranges>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
 #include "memorychain.h"
 
 typedef etl::MemoryChain<uint8_t> MemoryChain;
 
+static_assert(std::forward_iterator<MemoryChain::Iterator>);
+static_assert(std::ranges::forward_range<const MemoryChain>);
+static_assert(std::ranges::view<MemoryChain::Segments>);
+static_assert(std::ranges::forward_range<MemoryChain::Segments>);
+
 auto main() -> int
 {
     {
@@ -203,4 +218,500 @@ auto main() -> int
 
         assert(chain.length() == 0);
     }
+
+    {
+        // Appending and the length do not walk the chain.
+        uint8_t data[1000];
+        MemoryChain fragments[1000];
+
+        MemoryChain chain;
+        for(size_t i = 0; i < 1000; i++)
+        {
+            data[i] = static_cast<uint8_t>(i);
+            fragments[i] = MemoryChain(&data[i], 1);
+            chain.add(fragments[i]);
+            assert(chain.length() == i + 1);
+        }
+
+        uint8_t taken[10];
+        size_t length = chain.take(taken, 3);
+        assert(length == 3);
+        assert(chain.length() == 997);
+
+        const uint8_t* fragment;
+        length = chain.next(fragment);
+        assert(length == 1 && fragment == &data[3]);
+        assert(chain.length() == 996);
+
+        // Drain all but the last fragment, then append to it.
+        uint8_t rest[1000];
+        length = chain.take(rest, 995);
+        assert(length == 995);
+        assert(chain.length() == 1);
+
+        uint8_t _f1[] = { 1, 2, 3 };
+        MemoryChain f1( _f1, sizeof(_f1) );
+        chain.add(f1);
+        assert(chain.length() == 4);
+
+        length = chain.take(taken, sizeof(taken));
+        assert(length == 4);
+        uint8_t expected[] = { static_cast<uint8_t>(999), 1, 2, 3 };
+        assert(memcmp(taken, expected, sizeof(expected)) == 0);
+        assert(chain.length() == 0);
+    }
+
+    {
+        // Appending a chain appends all of its fragments.
+        uint8_t _f1[] = { 1, 2, 3 };
+        MemoryChain f1( _f1, sizeof(_f1) );
+
+        uint8_t _f2[] = { 4 };
+        MemoryChain f2( _f2, sizeof(_f2) );
+
+        uint8_t _f3[] = { 5, 6 };
+        MemoryChain f3( _f3, sizeof(_f3) );
+
+        uint8_t _f4[] = { 7 };
+        MemoryChain f4( _f4, sizeof(_f4) );
+
+        f3.add(f4);
+        MemoryChain chain = f1.add(f2).add(f3);
+        assert(chain.length() == 7);
+
+        uint8_t _f5[] = { 8 };
+        MemoryChain f5( _f5, sizeof(_f5) );
+        chain.add(f5);
+        assert(chain.length() == 8);
+
+        uint8_t taken[8];
+        size_t length = chain.take(taken, sizeof(taken));
+        assert(length == 8);
+        uint8_t expected[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+        assert(memcmp(taken, expected, sizeof(expected)) == 0);
+    }
+
+    {
+        uint8_t _f1[] = { 1, 2, 3 };
+        MemoryChain f1( _f1, sizeof(_f1) );
+
+        uint8_t _f2[] = { 4 };
+        MemoryChain f2( _f2, sizeof(_f2) );
+
+        uint8_t _f3[] = { 5, 6 };
+        MemoryChain f3( _f3, sizeof(_f3) );
+
+        MemoryChain chain = f1.add(f2).add(f3);
+
+        {
+            struct iovec vector[4];
+            size_t length = 6;
+            size_t count = chain.gather(vector, 4, 0, length);
+            assert(count == 3);
+            assert(length == 6);
+            assert(vector[0].iov_base == _f1 && vector[0].iov_len == 3);
+            assert(vector[1].iov_base == _f2 && vector[1].iov_len == 1);
+            assert(vector[2].iov_base == _f3 && vector[2].iov_len == 2);
+        }
+
+        {
+            // From an offset, for a length.
+            struct iovec vector[4];
+            size_t length = 3;
+            size_t count = chain.gather(vector, 4, 2, length);
+            assert(count == 3);
+            assert(length == 3);
+            assert(vector[0].iov_base == &_f1[2] && vector[0].iov_len == 1);
+            assert(vector[2].iov_base == _f3 && vector[2].iov_len == 1);
+        }
+
+        {
+            // The iovec array is too small.
+            struct iovec vector[2];
+            size_t length = 6;
+            size_t count = chain.gather(vector, 2, 0, length);
+            assert(count == 2);
+            assert(length == 4);
+        }
+
+        {
+            // Zero copy through a pipe.
+            int pipe[2];
+            int result = ::pipe(pipe);
+            assert(result == 0);
+
+            struct iovec vector[4];
+            size_t length = chain.length();
+            size_t count = chain.gather(vector, 4, 0, length);
+            ssize_t written = writev(pipe[1], vector, count);
+            assert(written == 6);
+
+            uint8_t received[3][2];
+            struct iovec buffers[3] = {
+                { received[0], sizeof(received[0]) },
+                { received[1], sizeof(received[1]) },
+                { received[2], sizeof(received[2]) },
+            };
+            ssize_t read = readv(pipe[0], buffers, 3);
+            assert(read == 6);
+
+            MemoryChain nodes[3];
+            MemoryChain copy;
+            copy.add(nodes, buffers, 3, read);
+            assert(copy.length() == 6);
+
+            uint8_t taken[6];
+            size_t took = copy.take(taken, sizeof(taken));
+            assert(took == 6);
+            uint8_t expected[] = { 1, 2, 3, 4, 5, 6 };
+            assert(memcmp(taken, expected, sizeof(expected)) == 0);
+
+            close(pipe[0]);
+            close(pipe[1]);
+        }
+
+        {
+            // Zero copy through a socket pair, receiving less than the buffers hold.
+            int sockets[2];
+            int result = socketpair(AF_UNIX, SOCK_STREAM, 0, sockets);
+            assert(result == 0);
+
+            struct iovec vector[4];
+            size_t length = 4;
+            struct msghdr message = {};
+            message.msg_iov = vector;
+            message.msg_iovlen = chain.gather(vector, 4, 2, length);
+            assert(length == 4);
+            ssize_t sent = sendmsg(sockets[0], &message, 0);
+            assert(sent == 4);
+
+            uint8_t received[8];
+            struct iovec buffers[2] = {
+                { &received[0], 3 },
+                { &received[3], 5 },
+            };
+            message.msg_iov = buffers;
+            message.msg_iovlen = 2;
+            ssize_t read = recvmsg(sockets[1], &message, 0);
+            assert(read == 4);
+
+            MemoryChain nodes[2];
+            MemoryChain copy;
+            copy.add(nodes, buffers, 2, read);
+            assert(copy.length() == 4);
+
+            uint8_t taken[4];
+            size_t took = copy.take(taken, sizeof(taken));
+            assert(took == 4);
+            uint8_t expected[] = { 3, 4, 5, 6 };
+            assert(memcmp(taken, expected, sizeof(expected)) == 0);
+
+            close(sockets[0]);
+            close(sockets[1]);
+        }
+    }
+
+    {
+        // Slicing through an index gives the same result as walking the chain.
+        uint8_t data[300];
+        MemoryChain fragments[100];
+
+        MemoryChain chain;
+        for(size_t i = 0; i < 300; i++)
+        {
+            data[i] = static_cast<uint8_t>(i);
+        }
+        size_t offset = 0;
+        for(size_t i = 0; i < 100; i++)
+        {
+            // Fragments of 1 to 5 elements, with some empty ones.
+            size_t length = (i % 7 == 3) ? 0 : 1 + i % 5;
+            fragments[i] = MemoryChain(&data[offset], length);
+            offset += length;
+            chain.add(fragments[i]);
+        }
+        const size_t length = chain.length();
+
+        // Fewer entries than fragments, every few fragments are indexed.
+        MemoryChain::Index::Entry entries[16];
+        MemoryChain::Index index(entries, 16);
+        chain.attach(index);
+
+        for(size_t offset = 0; offset < length + 2; offset++)
+        {
+            uint8_t slice[7];
+            size_t sliced = sizeof(slice);
+            const uint8_t* s = chain.slice(slice, offset, sliced);
+            assert(sliced == ((offset < length) ? std::min(sizeof(slice), length - offset) : 0));
+            for(size_t i = 0; i < sliced; i++)
+            {
+                assert(s[i] == data[offset + i]);
+            }
+        }
+
+        // The index follows the chain when it changes.
+        uint8_t taken[10];
+        size_t took = chain.take(taken, 10);
+        assert(took == 10);
+
+        uint8_t _f1[] = { 1, 2, 3 };
+        MemoryChain f1( _f1, sizeof(_f1) );
+        chain.add(f1);
+
+        for(size_t offset = 0; offset < length - 10; offset += 3)
+        {
+            uint8_t slice[2];
+            size_t sliced = sizeof(slice);
+            const uint8_t* s = chain.slice(slice, offset, sliced);
+            assert(sliced == 2);
+            assert(s[0] == data[10 + offset]);
+        }
+
+        uint8_t slice[3];
+        size_t sliced = sizeof(slice);
+        const uint8_t* s = chain.slice(slice, length - 10, sliced);
+        assert(sliced == 3 && s == _f1);
+
+        chain.detach();
+        sliced = sizeof(slice);
+        s = chain.slice(slice, length - 10, sliced);
+        assert(sliced == 3 && s == _f1);
+    }
+
+    {
+        uint8_t _f1[] = { 1, 2, 3 };
+        MemoryChain f1( _f1, sizeof(_f1) );
+
+        uint8_t _f2[] = { 4 };
+        MemoryChain f2( _f2, sizeof(_f2) );
+
+        uint8_t _f3[] = { 5, 6 };
+        MemoryChain f3( _f3, sizeof(_f3) );
+
+        MemoryChain chain;
+        chain.add(f1).add(f2).add(f3);
+
+        // Two readers walk the same chain independently.
+        MemoryChain::Reader parser(chain);
+        MemoryChain::Reader checksum(chain);
+
+        uint8_t read[6];
+        size_t count = parser.read(read, 2);
+        assert(count == 2);
+        assert(read[0] == 1 && read[1] == 2);
+
+        unsigned sum = 0;
+        uint8_t byte;
+        while(checksum.read(&byte, 1) == 1)
+        {
+            sum += byte;
+        }
+        assert(sum == 21 && checksum.remaining() == 0 && checksum.position() == 6);
+
+        // Peek in place within a fragment, copied across fragments.
+        uint8_t peeked[4];
+        size_t length = 1;
+        const uint8_t* p = parser.peek(peeked, length);
+        assert(length == 1 && p == &_f1[2]);
+
+        length = 3;
+        p = parser.peek(peeked, length);
+        assert(length == 3 && p == peeked);
+        assert(p[0] == 3 && p[1] == 4 && p[2] == 5);
+
+        length = 4;
+        p = parser.peek(peeked, length);
+        assert(length == 4 && p[3] == 6);
+        assert(parser.position() == 2);
+
+        count = parser.skip(3);
+        assert(count == 3);
+        count = parser.read(read, 6);
+        assert(count == 1 && read[0] == 6);
+        count = parser.skip(1);
+        assert(count == 0 && parser.remaining() == 0);
+
+        // Fragments added later are read on.
+        uint8_t _f4[] = { 7, 8 };
+        MemoryChain f4( _f4, sizeof(_f4) );
+        chain.add(f4);
+
+        assert(parser.remaining() == 2);
+        count = parser.read(read, 6);
+        assert(count == 2 && read[0] == 7 && read[1] == 8);
+
+        parser.rewind();
+        assert(parser.position() == 0 && parser.remaining() == 8);
+        count = parser.read(read, 6);
+        assert(count == 6);
+        for(uint8_t i = 0; i < 6; i++)
+        {
+            assert(read[i] == i + 1);
+        }
+
+        // The chain itself was not consumed.
+        assert(chain.length() == 8);
+    }
+
+    {
+        // Taking from a long chain does not recurse per fragment.
+        const size_t fragments = 100000;
+        static uint8_t data[fragments];
+        static MemoryChain nodes[fragments];
+
+        MemoryChain chain;
+        for(size_t i = 0; i < fragments; i++)
+        {
+            data[i] = static_cast<uint8_t>(i);
+            nodes[i] = MemoryChain(&data[i], 1);
+            chain.add(nodes[i]);
+        }
+
+        static uint8_t taken[fragments];
+        size_t took = chain.take(taken, fragments);
+        assert(took == fragments);
+        assert(memcmp(taken, data, fragments) == 0);
+        assert(chain.length() == 0);
+    }
+
+    {
+        MemoryChain chain;
+        assert(chain.begin() == chain.end());
+        assert(chain.segments().empty());
+
+        uint8_t _f1[] = { 1, 2, 3 };
+        MemoryChain f1( _f1, sizeof(_f1) );
+
+        uint8_t _f2[] = { 4 };
+        MemoryChain f2( _f2, sizeof(_f2) );
+
+        MemoryChain f3( _f2, 0 );
+
+        uint8_t _f4[] = { 5, 6 };
+        MemoryChain f4( _f4, sizeof(_f4) );
+
+        chain.add(f1).add(f2).add(f3).add(f4);
+
+        // Byte iterator with standard algorithms and ranges.
+        const uint8_t expected[] = { 1, 2, 3, 4, 5, 6 };
+        assert(std::ranges::equal(chain, expected));
+        assert(std::distance(chain.begin(), chain.end()) == 6);
+        assert(std::accumulate(chain.begin(), chain.end(), 0u) == 21);
+
+        MemoryChain::Iterator four = std::find(chain.begin(), chain.end(), 4);
+        assert(four != chain.end() && *four == 4);
+        assert(four.segment().size() == 1 && four.segment().data() == _f2);
+
+        MemoryChain::Iterator five = four;
+        assert(*++five == 5 && *five++ == 5 && *five == 6);
+        assert(++five == chain.end());
+
+        assert(std::ranges::count_if(chain, [](uint8_t byte) { return byte % 2 == 0; }) == 3);
+
+        // Segments, without the empty fragment.
+        size_t segments = 0;
+        unsigned sum = 0;
+        for(std::span<const uint8_t> segment : chain.segments())
+        {
+            segments++;
+            for(uint8_t byte : segment)
+            {
+                sum += byte;
+            }
+        }
+        assert(segments == 3 && sum == 21);
+
+        assert((*chain.segments().begin()).data() == _f1);
+        assert(std::ranges::distance(chain.segments() | std::views::join) == 6);
+    }
+
+    {
+        const char _f1[] = "GET / HTTP/1.1\r";
+        const char _f2[] = "\nHost: x\r\n";
+        const char _f3[] = "\r";
+        const char _f4[] = "\n\r\n";
+
+        etl::MemoryChain<char> f1( _f1, strlen(_f1) );
+        etl::MemoryChain<char> f2( _f2, strlen(_f2) );
+        etl::MemoryChain<char> f3( _f3, strlen(_f3) );
+        etl::MemoryChain<char> f4( _f4, strlen(_f4) );
+
+        etl::MemoryChain<char> chain;
+        chain.add(f1).add(f2).add(f3).add(f4);
+
+        // Delimiters straddling fragments.
+        size_t offset = 0;
+        bool found = chain.find("\r\n", 2, offset);
+        assert(found && offset == 14);
+
+        offset += 2;
+        found = chain.find("\r\n", 2, offset);
+        assert(found && offset == 23);
+
+        offset += 2;
+        found = chain.find("\r\n", 2, offset);
+        assert(found && offset == 25);
+
+        offset = 0;
+        found = chain.find("\r\n\r\n", 4, offset);
+        assert(found && offset == 23);
+
+        offset = 0;
+        found = chain.find(':', offset);
+        assert(found && offset == 20);
+
+        char slice[4];
+        size_t length = 4;
+        const char* s = chain.slice(slice, offset - 4, length);
+        assert(length == 4 && memcmp(s, "Host", 4) == 0);
+
+        // Not found, also when only a partial match is left at the end.
+        offset = 0;
+        found = chain.find('z', offset);
+        assert(!found && offset == 0);
+        found = chain.find("\n\r\n\r\n\r", 6, offset);
+        assert(!found);
+        offset = 26;
+        found = chain.find("\n\n", 2, offset);
+        assert(!found);
+
+        // An empty pattern is found at the offset.
+        offset = 3;
+        found = chain.find("", 0, offset);
+        assert(found && offset == 3);
+    }
+
+    {
+        // Compare with a plain search over every offset, in fragments longer than the vector width.
+        std::vector<uint8_t> data(1000);
+        for(size_t i = 0; i < data.size(); i++)
+        {
+            data[i] = static_cast<uint8_t>((i * 7919) % 13);
+        }
+
+        std::vector<MemoryChain> nodes;
+        nodes.reserve(data.size());
+
+        MemoryChain chain;
+        for(size_t at = 0, size = 1; at < data.size(); at += size, size = (size * 3) % 97 + 1)
+        {
+            nodes.emplace_back(&data[at], std::min(size, data.size() - at));
+            chain.add(nodes.back());
+        }
+
+        const uint8_t pattern[] = { 7, 1, 8 };
+        for(size_t length = 1; length <= sizeof(pattern); length++)
+        {
+            for(size_t from = 0; from <= data.size(); from++)
+            {
+                auto expected = std::search(data.begin() + from, data.end(), pattern, pattern + length);
+
+                size_t offset = from;
+                bool found = chain.find(pattern, length, offset);
+
+                assert(found == (expected != data.end()));
+                assert(!found || offset == static_cast<size_t>(expected - data.begin()));
+            }
+        }
+    }
 }
@@ -2,10 +2,265 @@
 #include <stddef.h>
 #include <string.h>
 
+#include <atomic>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
 #include "pool.h"
 
 typedef etl::Pool<uint8_t> Pool;
 
+struct Tracked
+{
+    static inline int alive = 0;
+
+    uint32_t value;
+
+    explicit Tracked(uint32_t value) :
+            value(value)
+    {
+        alive++;
+    }
+
+    ~Tracked()
+    {
+        alive--;
+    }
+};
+
+// Element of the concurrency tests.
+struct Element
+{
+    // A free element stores its link over the start of the payload.
+    uint64_t payload[3];
+    std::atomic<int> owners;
+};
+
+// Every thread goes through its own cache.
+class CacheClient
+{
+public:
+    explicit CacheClient(etl::Pool<Element>& pool) :
+            cache(pool, 4)
+    {
+    }
+
+    Element* take()
+    {
+        return cache.take();
+    }
+
+    bool release(Element& element)
+    {
+        return cache.release(element);
+    }
+
+private:
+    etl::Pool<Element>::Cache cache;
+};
+
+// Takes and releases through the batch interface, a varying number of elements at a time.
+class BatchClient
+{
+public:
+    explicit BatchClient(etl::Pool<Element>& pool) :
+            pool(pool)
+    {
+    }
+
+    ~BatchClient()
+    {
+        bool success = flush();
+        assert(success);
+        success = (pool.release(taken, available) == available);
+        assert(success);
+    }
+
+    Element* take()
+    {
+        if(available == 0)
+        {
+            batch = batch % burst + 1;
+            available = pool.take(taken, batch);
+        }
+
+        return (available > 0) ? taken[--available] : nullptr;
+    }
+
+    bool release(Element& element)
+    {
+        released[count++] = &element;
+
+        return (count < burst) || flush();
+    }
+
+private:
+    static constexpr size_t burst = 12;
+
+    etl::Pool<Element>& pool;
+    Element* taken[burst];
+    size_t available = 0;
+    size_t batch = 0;
+    Element* released[burst];
+    size_t count = 0;
+
+    bool flush()
+    {
+        const bool success = (pool.release(released, count) == count);
+        count = 0;
+
+        return success;
+    }
+};
+
+typedef etl::StaticPool<Element, 16, true> StaticElementPool;
+
+// Constructs and destroys elements in place.
+class StaticClient
+{
+public:
+    explicit StaticClient(StaticElementPool& pool) :
+            pool(pool)
+    {
+    }
+
+    Element* take()
+    {
+        return pool.emplace();
+    }
+
+    bool release(Element& element)
+    {
+        return pool.destroy(&element);
+    }
+
+private:
+    StaticElementPool& pool;
+};
+
+// Takes and releases elements of pool from 4 threads, each through its own Client made from pool,
+// holding up to hold elements at a time, and checks that no element is handed out twice.
+// The first thread calls maintain, when given, every 1000 rounds.
+// Returns the number of elements available afterwards.
+template<typename Client, typename Pool>
+static size_t share(Pool& pool, size_t hold, std::type_identity_t<void (*)(Pool&)> maintain = nullptr)
+{
+    constexpr size_t threads = 4;
+    constexpr size_t rounds = 20000;
+
+    // No element is owned yet.
+    {
+        Client client(pool);
+        std::vector<Element*> elements;
+        while(Element* element = client.take())
+        {
+            element->owners = 0;
+            elements.push_back(element);
+        }
+        for(Element* element : elements)
+        {
+            bool success = client.release(*element);
+            assert(success);
+        }
+    }
+
+    std::atomic<bool> failed = false;
+    std::vector<std::thread> workers;
+    for(size_t t = 0; t < threads; t++)
+    {
+        workers.emplace_back([&pool, &failed, hold, maintain, t]()
+        {
+            Client client(pool);
+            std::vector<Element*> held;
+
+            for(size_t i = 0; i < rounds; i++)
+            {
+                // Hold a varying number of elements.
+                if((i / hold) % 2 == 0)
+                {
+                    Element* element = client.take();
+                    if(element == nullptr)
+                    {
+                        std::this_thread::yield();
+                        continue;
+                    }
+
+                    // No element may be handed out twice.
+                    if(element->owners.fetch_add(1) != 0)
+                    {
+                        failed = true;
+                    }
+                    // Overwrite the link, a stale link then indexes past the last element of a huge page slab.
+                    element->payload[0] = (t << 16) | 0xffff;
+                    element->payload[1] = t;
+                    element->payload[2] = i;
+                    held.push_back(element);
+                }
+                else if(!held.empty())
+                {
+                    Element* element = held.back();
+                    held.pop_back();
+                    if(element->payload[1] != t)
+                    {
+                        failed = true;
+                    }
+                    element->owners.fetch_sub(1);
+
+                    if(!client.release(*element))
+                    {
+                        failed = true;
+                    }
+                }
+
+                if(i % 8 == 0)
+                {
+                    std::this_thread::yield();
+                }
+
+                if(t == 0 && maintain != nullptr && i % 1000 == 0)
+                {
+                    maintain(pool);
+                }
+            }
+
+            for(Element* element : held)
+            {
+                element->owners.fetch_sub(1);
+                if(!client.release(*element))
+                {
+                    failed = true;
+                }
+            }
+        });
+    }
+    for(std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    assert(!failed);
+
+    // All elements are back in the pool.
+    Client client(pool);
+    std::vector<Element*> elements;
+    while(Element* element = client.take())
+    {
+        elements.push_back(element);
+    }
+    for(Element* element : elements)
+    {
+        bool success = client.release(*element);
+        assert(success);
+    }
+
+    return elements.size();
+}
+
+// A static pool is constant initialized, it needs no start-up code.
+constinit etl::StaticPool<Tracked, 4> trackedPool;
+
 auto main() -> int
 {
     {
@@ -44,4 +299,440 @@ auto main() -> int
         success = pool.release(*element2);
         assert(!success);
     }
+
+    {
+        Pool pool(4);
+
+        uint8_t* element1 = pool.take();
+        uint8_t* element2 = pool.take();
+        assert(element1 != nullptr && element2 != nullptr && element1 != element2);
+
+        // The most recently released element is taken first.
+        bool success = pool.release(*element1);
+        assert(success);
+        success = pool.release(*element2);
+        assert(success);
+
+        uint8_t* element = pool.take();
+        assert(element == element2);
+        element = pool.take();
+        assert(element == element1);
+    }
+
+    {
+        etl::Pool<Element> pool(16);
+
+        const size_t available = share<etl::Pool<Element>&>(pool, 1);
+        assert(available == 16);
+    }
+
+    {
+        Pool pool(8);
+
+        {
+            Pool::Cache cache(pool, 2);
+
+            // The first take moves a batch from the pool into the cache.
+            uint8_t* element1 = cache.take();
+            assert(element1 != nullptr);
+            assert(cache.elements() == 1);
+
+            uint8_t* element2 = cache.take();
+            assert(element2 != nullptr && element2 != element1);
+            assert(cache.elements() == 0);
+
+            // Released elements are taken again first.
+            cache.release(*element1);
+            uint8_t* element = cache.take();
+            assert(element == element1);
+
+            cache.release(*element1);
+            cache.release(*element2);
+            assert(cache.elements() == 2);
+
+            // Drain the pool through the cache.
+            std::vector<uint8_t*> elements;
+            while(uint8_t* element = cache.take())
+            {
+                elements.push_back(element);
+            }
+            assert(elements.size() == 8);
+            assert(!pool.haveAvailable());
+
+            // Overflowing the cache gives a batch back to the pool.
+            for(uint8_t* element : elements)
+            {
+                cache.release(*element);
+            }
+            assert(cache.elements() <= 4);
+            assert(pool.haveAvailable());
+        }
+
+        // The destructor flushed the cache into the pool.
+        size_t available = 0;
+        while(pool.take() != nullptr)
+        {
+            available++;
+        }
+        assert(available == 8);
+    }
+
+    {
+        etl::Pool<Element> pool(64);
+
+        const size_t available = share<CacheClient>(pool, 16);
+        assert(available == 64);
+    }
+
+    {
+        Pool pool(8);
+
+        uint8_t* elements[10] = {};
+
+        size_t count = pool.take(elements, 3);
+        assert(count == 3);
+        assert(elements[0] != elements[1] && elements[1] != elements[2] && elements[0] != elements[2]);
+
+        // Only the available elements are taken.
+        count = pool.take(&elements[3], 7);
+        assert(count == 5);
+        assert(!pool.haveAvailable());
+        count = pool.take(elements, 1);
+        assert(count == 0);
+
+        count = pool.release(elements, 8);
+        assert(count == 8);
+
+        // Releasing more elements than the pool holds is refused.
+        count = pool.release(elements, 1);
+        assert(count == 0);
+
+        count = pool.take(elements, 8);
+        assert(count == 8);
+        count = pool.release(&elements[2], 6);
+        assert(count == 6);
+        count = pool.release(elements, 8);
+        assert(count == 2);
+
+        // The batch is taken again in the order it was released.
+        count = pool.take(elements, 2);
+        assert(count == 2);
+        count = pool.take(&elements[2], 6);
+        assert(count == 6);
+        for(size_t i = 0; i < 8; i++)
+        {
+            for(size_t j = i + 1; j < 8; j++)
+            {
+                assert(elements[i] != elements[j]);
+            }
+        }
+        count = pool.release(elements, 8);
+        assert(count == 8);
+    }
+
+    {
+        etl::Pool<Element> pool(64);
+
+        const size_t available = share<BatchClient>(pool, 16);
+        assert(available == 64);
+    }
+
+    {
+        Pool pool(2);
+
+        {
+            Pool::Handle handle1(pool);
+            assert(handle1);
+            *handle1 = 1;
+
+            Pool::Handle handle2(pool);
+            assert(handle2);
+            assert(handle1.get() != handle2.get());
+
+            // The pool is exhausted.
+            Pool::Handle handle3(pool);
+            assert(!handle3);
+
+            // Moving transfers ownership.
+            handle3 = std::move(handle1);
+            assert(!handle1);
+            assert(*handle3 == 1);
+
+            handle2.reset();
+            assert(!handle2);
+            assert(pool.haveAvailable());
+
+            uint8_t* element = handle3.detach();
+            assert(!handle3);
+            Pool::Handle handle4(pool, element);
+            assert(handle4.get() == element);
+        }
+
+        // All handles released their element.
+        uint8_t* elements[3];
+        size_t count = pool.take(elements, 3);
+        assert(count == 2);
+        count = pool.release(elements, 2);
+        assert(count == 2);
+    }
+
+    {
+        struct Frame
+        {
+            uint32_t sequence;
+            uint8_t bytes[60];
+        };
+
+        typedef etl::PooledShared<Frame> Shared;
+
+        Shared::Pool pool(2);
+
+        {
+            Shared frame(pool);
+            assert(frame);
+            assert(frame.references() == 1);
+            frame->sequence = 7;
+
+            Shared copy = frame;
+            assert(copy.get() == frame.get());
+            assert(frame.references() == 2);
+
+            Shared other(pool);
+            assert(other);
+            Shared exhausted(pool);
+            assert(!exhausted);
+
+            // Assigning drops the last reference to other.
+            other = copy;
+            assert(frame.references() == 3);
+            assert(pool.haveAvailable());
+
+            Shared moved = std::move(copy);
+            assert(!copy);
+            assert(moved->sequence == 7);
+            assert(frame.references() == 3);
+
+            frame.reset();
+            other.reset();
+            assert(moved.references() == 1);
+
+            // Fan out one frame to several consumers.
+            std::vector<std::thread> consumers;
+            std::atomic<uint32_t> sum = 0;
+            for(size_t i = 0; i < 4; i++)
+            {
+                consumers.emplace_back([shared = moved, &sum]()
+                {
+                    sum += shared->sequence;
+                });
+            }
+            moved.reset();
+            for(std::thread& consumer : consumers)
+            {
+                consumer.join();
+            }
+            assert(sum == 28);
+        }
+
+        // The last owner released the frame.
+        Shared::Element* elements[3];
+        size_t count = pool.take(elements, 3);
+        assert(count == 2);
+        count = pool.release(elements, 2);
+        assert(count == 2);
+    }
+
+    {
+        assert(trackedPool.haveAvailable());
+
+        Tracked* elements[4];
+        for(uint32_t i = 0; i < 4; i++)
+        {
+            elements[i] = trackedPool.emplace(i + 10);
+            assert(elements[i] != nullptr);
+            assert(elements[i]->value == i + 10);
+        }
+        assert(Tracked::alive == 4);
+        assert(!trackedPool.haveAvailable());
+        Tracked* element = trackedPool.emplace(0u);
+        assert(element == nullptr);
+
+        trackedPool.destroy(elements[1]);
+        assert(Tracked::alive == 3);
+        assert(trackedPool.haveAvailable());
+
+        // The released slot is used again.
+        element = trackedPool.emplace(20u);
+        assert(element == elements[1]);
+        assert(element->value == 20);
+
+        for(Tracked* element : elements)
+        {
+            trackedPool.destroy(element);
+        }
+        assert(Tracked::alive == 0);
+    }
+
+    {
+        struct alignas(32) Wide
+        {
+            uint8_t bytes[40];
+        };
+
+        etl::StaticPool<Wide, 3> pool;
+        Wide* element1 = pool.emplace();
+        Wide* element2 = pool.emplace();
+        assert(reinterpret_cast<uintptr_t>(element1) % 32 == 0);
+        assert(reinterpret_cast<uintptr_t>(element2) % 32 == 0);
+        pool.destroy(element1);
+        pool.destroy(element2);
+
+        // Padded slots never share a cache line.
+        etl::StaticPool<uint32_t, 3, true> padded;
+        uint32_t* number1 = padded.emplace(1u);
+        uint32_t* number2 = padded.emplace(2u);
+        assert(reinterpret_cast<uintptr_t>(number1) % ETL_CACHE_LINE_SIZE == 0);
+        assert(reinterpret_cast<uintptr_t>(number2) - reinterpret_cast<uintptr_t>(number1) == ETL_CACHE_LINE_SIZE);
+        padded.destroy(number1);
+        padded.destroy(number2);
+    }
+
+    {
+        static StaticElementPool pool;
+
+        const size_t available = share<StaticClient>(pool, 1);
+        assert(available == 16);
+    }
+
+    {
+        struct Element
+        {
+            uint64_t payload[5];
+        };
+
+        for(etl::SlabMemory memory : { etl::SlabMemory::heap, etl::SlabMemory::mapped })
+        {
+            // Slabs of 3 elements are rounded up to 4.
+            etl::SlabPool<Element> pool(3, 3, 1, memory);
+            assert(pool.size() == 4);
+
+            // The pool grows a slab at a time, up to the maximum.
+            std::vector<Element*> elements;
+            while(Element* element = pool.take())
+            {
+                element->payload[0] = elements.size();
+                element->payload[4] = elements.size();
+                elements.push_back(element);
+            }
+            assert(elements.size() == 12);
+            assert(pool.size() == 12);
+            assert(!pool.haveAvailable());
+
+            for(size_t i = 0; i < elements.size(); i++)
+            {
+                assert(elements[i]->payload[0] == i && elements[i]->payload[4] == i);
+                for(size_t j = i + 1; j < elements.size(); j++)
+                {
+                    assert(elements[i] != elements[j]);
+                }
+            }
+
+            // Elements from every slab are released.
+            for(Element* element : elements)
+            {
+                bool success = pool.release(*element);
+                assert(success);
+            }
+            bool success = pool.release(*elements[0]);
+            assert(!success);
+
+            // Keep one slab in use.
+            Element* element = pool.take();
+
+            size_t trimmed = pool.trim();
+            if(memory == etl::SlabMemory::heap)
+            {
+                assert(trimmed == 0);
+                assert(pool.size() == 12);
+            }
+            else
+            {
+                assert(trimmed == 2);
+                assert(pool.size() == 4);
+                trimmed = pool.trim();
+                assert(trimmed == 0);
+            }
+
+            // Trimmed slabs are used again.
+            elements.clear();
+            while(Element* element = pool.take())
+            {
+                elements.push_back(element);
+            }
+            assert(elements.size() == 11);
+            assert(pool.size() == 12);
+
+            elements.push_back(element);
+            for(Element* element : elements)
+            {
+                success = pool.release(*element);
+                assert(success);
+            }
+        }
+    }
+
+    {
+        struct Element
+        {
+            uint64_t payload[5];
+        };
+
+        // Huge page slabs fill whole huge pages and start on one.
+        const size_t hugePage = size_t(2) << 20;
+
+        etl::SlabPool<Element> pool(3, 2, 1, etl::SlabMemory::hugePages);
+        assert(pool.size() == hugePage / sizeof(Element) - 1);
+
+        Element* element = pool.take();
+        assert(element != nullptr);
+        assert(reinterpret_cast<uintptr_t>(element) % hugePage == sizeof(Element));
+
+        bool success = pool.release(*element);
+        assert(success);
+
+        size_t trimmed = pool.trim();
+        assert(trimmed == 1);
+        assert(pool.size() == 0);
+
+        element = pool.take();
+        assert(element != nullptr);
+        assert(pool.size() == hugePage / sizeof(Element) - 1);
+        success = pool.release(*element);
+        assert(success);
+    }
+
+    {
+        etl::SlabPool<Element> pool(16, 8, 0, etl::SlabMemory::mapped);
+        assert(pool.size() == 0);
+
+        // Slabs are trimmed and grown again while the other threads take and release.
+        const size_t available = share<etl::SlabPool<Element>&>(pool, 24, [](etl::SlabPool<Element>& pool) { pool.trim(); });
+        assert(available == 16 * 8);
+
+        pool.trim();
+        assert(pool.size() == 0);
+    }
+
+    {
+        // Huge page slabs hold fewer elements than an index can address in a slab.
+        const size_t slabElements = (size_t(2) << 20) / sizeof(Element) - 1;
+
+        // Trimming walks the free list while the other threads overwrite the links of the elements they take.
+        etl::SlabPool<Element> pool(16, 2, 0, etl::SlabMemory::hugePages);
+        const size_t available = share<etl::SlabPool<Element>&>(pool, 24, [](etl::SlabPool<Element>& pool) { pool.trim(); });
+        assert(available == slabElements * 2);
+
+        pool.trim();
+        assert(pool.size() == 0);
+    }
 }
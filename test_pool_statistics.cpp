@@ -0,0 +1,194 @@
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <thread>
+#include <vector>
+
+#define ETL_POOL_STATISTICS
+#define ETL_POOL_DEBUG
+
+#include "pool.h"
+
+typedef etl::Pool<uint64_t> Pool;
+
+auto main() -> int
+{
+    {
+        Pool pool(3);
+
+        etl::PoolStatistics statistics = pool.statistics();
+        assert(statistics.taken == 0);
+        assert(statistics.released == 0);
+        assert(statistics.inUse == 0);
+        assert(statistics.peak == 0);
+        assert(statistics.exhausted == 0);
+
+        uint64_t* element1 = pool.take();
+        uint64_t* element2 = pool.take();
+        uint64_t* element3 = pool.take();
+        uint64_t* element4 = pool.take();
+        assert(element4 == nullptr);
+        assert(pool.leaked() == 3);
+
+        statistics = pool.statistics();
+        assert(statistics.taken == 3);
+        assert(statistics.inUse == 3);
+        assert(statistics.peak == 3);
+        assert(statistics.exhausted == 1);
+
+        bool success = pool.release(*element1);
+        assert(success);
+        success = pool.release(*element2);
+        assert(success);
+
+        // A double release is detected, also when the pool is not full.
+        success = pool.release(*element1);
+        assert(!success);
+        assert(pool.leaked() == 1);
+
+        statistics = pool.statistics();
+        assert(statistics.released == 2);
+        assert(statistics.inUse == 1);
+        assert(statistics.peak == 3);
+
+        // Batch releases stop at the first element that is not taken.
+        uint64_t* elements[3] = {};
+        size_t count = pool.take(elements, 3);
+        assert(count == 2);
+        count = pool.take(elements, 1);
+        assert(count == 0);
+        assert(pool.statistics().exhausted == 3);
+
+        uint64_t* released[3] = { elements[0], elements[0], elements[1] };
+        count = pool.release(released, 3);
+        assert(count == 1);
+        count = pool.release(&elements[1], 1);
+        assert(count == 1);
+        assert(pool.leaked() == 1);
+
+        {
+            Pool::Cache cache(pool, 2);
+            uint64_t* cached = cache.take();
+            assert(cached != nullptr);
+            assert(pool.leaked() == 2);
+
+            // Elements in the cache count as in use.
+            assert(pool.statistics().inUse == 3);
+
+            success = cache.release(*cached);
+            assert(success);
+            assert(pool.leaked() == 1);
+
+            // A double release into the cache is refused, the element is not cached twice.
+            success = cache.release(*cached);
+            assert(!success);
+            assert(cache.elements() == 2);
+        }
+        assert(pool.statistics().inUse == 1);
+
+        success = pool.release(*element3);
+        assert(success);
+        assert(pool.leaked() == 0);
+
+        statistics = pool.statistics();
+        assert(statistics.taken == statistics.released);
+        assert(statistics.inUse == 0);
+    }
+
+    {
+        etl::StaticPool<uint32_t, 70> pool;
+
+        std::vector<uint32_t*> elements;
+        while(uint32_t* element = pool.emplace(7u))
+        {
+            elements.push_back(element);
+        }
+        assert(elements.size() == 70);
+        assert(pool.leaked() == 70);
+        assert(pool.statistics().exhausted == 1);
+
+        // A double destroy is refused, the slot is not handed out twice.
+        bool success = pool.destroy(elements[0]);
+        assert(success);
+        success = pool.destroy(elements[0]);
+        assert(!success);
+        assert(pool.leaked() == 69);
+
+        uint32_t* element1 = pool.emplace(8u);
+        uint32_t* element2 = pool.emplace(9u);
+        assert(element1 == elements[0] && element2 == nullptr);
+
+        for(uint32_t* element : elements)
+        {
+            success = pool.destroy(element);
+            assert(success);
+        }
+        assert(pool.leaked() == 0);
+        assert(pool.statistics().peak == 70);
+    }
+
+    {
+        etl::SlabPool<uint64_t> pool(4, 2, 1);
+
+        std::vector<uint64_t*> elements;
+        while(uint64_t* element = pool.take())
+        {
+            elements.push_back(element);
+        }
+        assert(elements.size() == 8);
+        assert(pool.leaked() == 8);
+
+        // Growing is not exhaustion, only reaching the maximum size is.
+        assert(pool.statistics().exhausted == 1);
+
+        bool success = pool.release(*elements[5]);
+        assert(success);
+        success = pool.release(*elements[5]);
+        assert(!success);
+        elements.erase(elements.begin() + 5);
+        for(uint64_t* element : elements)
+        {
+            success = pool.release(*element);
+            assert(success);
+        }
+        assert(pool.leaked() == 0);
+        assert(pool.statistics().inUse == 0);
+    }
+
+    {
+        constexpr size_t threads = 4;
+        constexpr size_t rounds = 10000;
+
+        Pool pool(8);
+
+        std::vector<std::thread> workers;
+        for(size_t t = 0; t < threads; t++)
+        {
+            workers.emplace_back([&pool]()
+            {
+                for(size_t i = 0; i < rounds; i++)
+                {
+                    uint64_t* element = pool.take();
+                    if(element == nullptr)
+                    {
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    bool success = pool.release(*element);
+                    assert(success);
+                }
+            });
+        }
+        for(std::thread& worker : workers)
+        {
+            worker.join();
+        }
+
+        const etl::PoolStatistics statistics = pool.statistics();
+        assert(statistics.taken == statistics.released);
+        assert(statistics.inUse == 0);
+        assert(statistics.peak >= 1 && statistics.peak <= 8);
+        assert(pool.leaked() == 0);
+    }
+}
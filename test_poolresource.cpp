@@ -0,0 +1,183 @@
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "poolresource.h"
+
+typedef etl::PoolResource<> Resource;
+
+// Counts the allocations that reach the upstream resource.
+class Counting : public std::pmr::memory_resource
+{
+public:
+    size_t allocations = 0;
+    size_t deallocations = 0;
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        allocations++;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* memory, size_t bytes, size_t alignment) override
+    {
+        deallocations++;
+        std::pmr::new_delete_resource()->deallocate(memory, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return (this == &other);
+    }
+};
+
+auto main() -> int
+{
+    {
+        Counting upstream;
+        Resource resource(4096, 16, etl::SlabMemory::heap, &upstream);
+
+        // Every size class hands out blocks aligned to the class size.
+        std::vector<void*> blocks;
+        for(size_t size = 1; size <= Resource::maxSize; size *= 3)
+        {
+            void* block = resource.allocate(size, 1);
+            const size_t sizeClass = std::max(std::bit_ceil(size), Resource::minSize);
+            assert(reinterpret_cast<uintptr_t>(block) % sizeClass == 0);
+            blocks.push_back(block);
+        }
+
+        // The alignment selects a larger class when needed.
+        void* aligned = resource.allocate(24, 256);
+        assert(reinterpret_cast<uintptr_t>(aligned) % 256 == 0);
+        resource.deallocate(aligned, 24, 256);
+
+        assert(upstream.allocations == 0);
+
+        // Larger allocations go upstream.
+        void* large = resource.allocate(Resource::maxSize + 1);
+        assert(upstream.allocations == 1);
+        resource.deallocate(large, Resource::maxSize + 1);
+        assert(upstream.deallocations == 1);
+
+        size_t size = 1;
+        for(void* block : blocks)
+        {
+            resource.deallocate(block, size, 1);
+            size *= 3;
+        }
+
+        assert(resource.is_equal(resource));
+        Resource other;
+        assert(!resource.is_equal(other));
+    }
+
+    {
+        Counting upstream;
+        Resource resource(4096, 64, etl::SlabMemory::mapped, &upstream);
+
+        {
+            std::pmr::vector<uint32_t> numbers(&resource);
+            for(uint32_t i = 0; i < 2000; i++)
+            {
+                numbers.push_back(i);
+            }
+            for(uint32_t i = 0; i < 2000; i++)
+            {
+                assert(numbers[i] == i);
+            }
+
+            std::pmr::map<uint32_t, std::pmr::string> names(&resource);
+            for(uint32_t i = 0; i < 100; i++)
+            {
+                names.emplace(i, std::pmr::string(i, 'x'));
+            }
+            for(uint32_t i = 0; i < 100; i++)
+            {
+                assert(names.at(i).size() == i);
+            }
+
+            std::vector<uint32_t, etl::PoolAllocator<uint32_t>> allocated{etl::PoolAllocator<uint32_t>(&resource)};
+            allocated.assign(10, 7);
+            assert(allocated[9] == 7);
+        }
+
+        // Only the vector outgrew the largest size class.
+        assert(upstream.allocations > 0);
+        assert(upstream.allocations == upstream.deallocations);
+
+        // All blocks are free again.
+        const size_t trimmed = resource.trim();
+        assert(trimmed > 0);
+    }
+
+    {
+        Counting upstream;
+
+        // One slab of 4 blocks in every size class.
+        etl::PoolResource<16, 64> resource(64, 1, etl::SlabMemory::heap, &upstream);
+
+        std::vector<void*> blocks;
+        for(size_t i = 0; i < 6; i++)
+        {
+            blocks.push_back(resource.allocate(16));
+        }
+
+        // An exhausted size class borrows from upstream.
+        assert(upstream.allocations == 2);
+
+        // Released in mixed order, borrowed blocks go back upstream and pool blocks to the pool.
+        std::swap(blocks[0], blocks[5]);
+        for(void* block : blocks)
+        {
+            resource.deallocate(block, 16);
+        }
+        assert(upstream.deallocations == 2);
+
+        for(size_t i = 0; i < 4; i++)
+        {
+            blocks[i] = resource.allocate(16);
+        }
+        assert(upstream.allocations == 2);
+        for(size_t i = 0; i < 4; i++)
+        {
+            resource.deallocate(blocks[i], 16);
+        }
+    }
+
+    {
+        Resource resource;
+
+        std::vector<std::thread> workers;
+        for(size_t t = 0; t < 4; t++)
+        {
+            workers.emplace_back([&resource, t]()
+            {
+                for(size_t i = 0; i < 200; i++)
+                {
+                    std::pmr::vector<std::pmr::string> strings(&resource);
+                    for(size_t j = 0; j < 10; j++)
+                    {
+                        strings.emplace_back(16 + (i * j + t) % 200, static_cast<char>('a' + t));
+                    }
+                    for(const std::pmr::string& string : strings)
+                    {
+                        assert(string.find_first_not_of(static_cast<char>('a' + t)) == std::pmr::string::npos);
+                    }
+                }
+            });
+        }
+        for(std::thread& worker : workers)
+        {
+            worker.join();
+        }
+    }
+}
@@ -2,10 +2,27 @@
 #include <stddef.h>
 #include <string.h>
 
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include "queue.h"
 
 typedef etl::Queue<uint8_t> Queue;
 
+struct Counted
+{
+    static inline int alive = 0;
+
+    int value;
+
+    Counted(int value = 0) : value(value) { alive++; }
+    Counted(const Counted& other) : value(other.value) { alive++; }
+    Counted& operator=(const Counted& other) = default;
+    ~Counted() { alive--; }
+};
+
 auto main() -> int
 {
     {
@@ -176,4 +193,505 @@ auto main() -> int
         assert(element == 2);
         assert(queue.elements() == 1);
     }
+
+    {
+        Queue queue(4);
+
+        uint8_t in[] = { 1, 2, 3, 4, 5, 6 };
+
+        size_t count = queue.enqueue(in, 3);
+        assert(count == 3);
+        assert(queue.elements() == 3);
+
+        uint8_t out[6] = {};
+        count = queue.dequeue(out, 2);
+        assert(count == 2);
+        assert(out[0] == 1 && out[1] == 2);
+
+        // Wraps around the end of the queue.
+        count = queue.enqueue(&in[3], 3);
+        assert(count == 3);
+        assert(queue.full());
+
+        count = queue.enqueue(in, 1);
+        assert(count == 0);
+
+        count = queue.dequeue(out, sizeof(out));
+        assert(count == 4);
+        uint8_t expected[] = { 3, 4, 5, 6 };
+        assert(memcmp(out, expected, sizeof(expected)) == 0);
+        assert(queue.empty());
+
+        count = queue.enqueue(in, sizeof(in));
+        assert(count == 4);
+        assert(queue.full());
+
+        count = queue.drain(out);
+        assert(count == 4);
+        assert(memcmp(out, in, 4) == 0);
+        assert(queue.empty());
+
+        count = queue.drain(out);
+        assert(count == 0);
+    }
+
+    {
+        Queue queue(4);
+
+        size_t count = 3;
+        uint8_t* reserved = queue.reserve(count);
+        assert(reserved != nullptr);
+        assert(count == 3);
+        assert(queue.empty());
+
+        reserved[0] = 1;
+        reserved[1] = 2;
+        queue.commit(2);
+        assert(queue.elements() == 2);
+
+        count = 4;
+        uint8_t* acquired = queue.acquire(count);
+        assert(acquired != nullptr);
+        assert(count == 2);
+        assert(acquired[0] == 1 && acquired[1] == 2);
+        assert(queue.elements() == 2);
+
+        queue.release(2);
+        assert(queue.empty());
+
+        // Only the contiguous part up to the end of the queue is reserved.
+        count = 4;
+        reserved = queue.reserve(count);
+        assert(count == 2);
+        reserved[0] = 3;
+        reserved[1] = 4;
+        queue.commit(count);
+
+        count = 4;
+        reserved = queue.reserve(count);
+        assert(count == 2);
+        assert(reserved != nullptr);
+        reserved[0] = 5;
+        reserved[1] = 6;
+        queue.commit(count);
+        assert(queue.full());
+
+        count = 1;
+        reserved = queue.reserve(count);
+        assert(reserved == nullptr);
+        assert(count == 0);
+
+        count = 4;
+        acquired = queue.acquire(count);
+        assert(count == 2);
+        assert(acquired[0] == 3 && acquired[1] == 4);
+        queue.release(count);
+
+        uint8_t element;
+        bool success = queue.dequeue(element);
+        assert(success);
+        assert(element == 5);
+
+        count = 4;
+        acquired = queue.acquire(count);
+        assert(count == 1);
+        assert(acquired[0] == 6);
+        queue.release(count);
+        assert(queue.empty());
+
+        count = 1;
+        acquired = queue.acquire(count);
+        assert(acquired == nullptr);
+        assert(count == 0);
+    }
+
+    {
+        etl::StaticQueue<uint8_t, 3> queue;
+
+        assert(queue.size() == 3);
+        assert(queue.empty());
+
+        for(size_t i = 0; i < UINT16_MAX; i++)
+        {
+            bool success = queue.enqueue(static_cast<uint8_t>(i));
+            assert(success);
+
+            uint8_t element;
+            success = queue.dequeue(element);
+            assert(success);
+            assert(element == static_cast<uint8_t>(i));
+        }
+
+        bool success = queue.enqueue(1);
+        assert(success);
+        success = queue.enqueue(2);
+        assert(success);
+        success = queue.enqueue(3);
+        assert(success);
+        assert(queue.full());
+        success = queue.enqueue(4);
+        assert(!success);
+
+        uint8_t out[3];
+        size_t count = queue.drain(out);
+        assert(count == 3);
+        uint8_t expected[] = { 1, 2, 3 };
+        assert(memcmp(out, expected, sizeof(expected)) == 0);
+    }
+
+    {
+        static etl::StaticQueue<uint32_t, 4> queue;
+
+        assert(queue.size() == 4);
+
+        uint32_t in[] = { 1, 2, 3 };
+        uint32_t out[4];
+
+        for(size_t i = 0; i < UINT16_MAX; i++)
+        {
+            size_t count = queue.enqueue(in, 3);
+            assert(count == 3);
+            assert(queue.elements() == 3);
+
+            count = queue.dequeue(out, 4);
+            assert(count == 3);
+            assert(memcmp(out, in, sizeof(in)) == 0);
+        }
+
+        assert(queue.empty());
+
+        size_t count = queue.enqueue(in, 3);
+        assert(count == 3);
+        count = queue.enqueue(in, 3);
+        assert(count == 1);
+        assert(queue.full());
+    }
+
+    {
+        const size_t size = 100000;
+
+        etl::Queue<uint32_t, uint32_t> queue(size);
+
+        assert(queue.size() == size);
+
+        std::vector<uint32_t> in(size);
+        for(uint32_t i = 0; i < size; i++)
+        {
+            in[i] = i;
+        }
+
+        for(size_t round = 0; round < 3; round++)
+        {
+            size_t count = queue.enqueue(in.data(), size / 2);
+            assert(count == size / 2);
+
+            count = queue.enqueue(&in[size / 2], size);
+            assert(count == size / 2);
+            assert(queue.full());
+            assert(queue.elements() == size);
+
+            std::vector<uint32_t> out(size);
+            count = queue.drain(out.data());
+            assert(count == size);
+            assert(out == in);
+            assert(queue.empty());
+
+            // Shift the wraparound point.
+            queue.enqueue(1);
+            uint32_t element;
+            queue.dequeue(element);
+        }
+    }
+
+    {
+        etl::Queue<uint8_t, uint64_t> queue(3);
+
+        for(size_t i = 0; i < 3; i++)
+        {
+            bool success = queue.enqueue(1);
+            assert(success);
+        }
+        bool success = queue.enqueue(1);
+        assert(!success);
+        assert(queue.elements() == 3);
+
+        etl::StaticQueue<uint8_t, 70000> large;
+        assert(large.size() == 70000);
+        success = large.enqueue(1);
+        assert(success);
+        assert(large.elements() == 1);
+    }
+
+    {
+        etl::Queue<uint32_t> queue(16);
+
+        const uint32_t count = 100000;
+
+        std::thread producer([&queue]()
+        {
+            for(uint32_t i = 0; i < count; )
+            {
+                if(queue.enqueue(i))
+                {
+                    i++;
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        for(uint32_t expected = 0; expected < count; )
+        {
+            uint32_t element;
+            if(queue.dequeue(element))
+            {
+                assert(element == expected);
+                expected++;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        producer.join();
+
+        assert(queue.empty());
+    }
+
+    {
+        etl::Queue<std::unique_ptr<int>> queue(2);
+
+        bool success = queue.enqueue(std::make_unique<int>(1));
+        assert(success);
+
+        success = queue.emplace(new int(2));
+        assert(success);
+
+        auto element = std::make_unique<int>(3);
+        success = queue.enqueue(std::move(element));
+        assert(!success);
+        assert(element != nullptr);
+
+        std::unique_ptr<int> dequeued;
+        success = queue.dequeue(dequeued);
+        assert(success);
+        assert(*dequeued == 1);
+
+        success = queue.dequeue(dequeued);
+        assert(success);
+        assert(*dequeued == 2);
+
+        success = queue.dequeue(dequeued);
+        assert(!success);
+    }
+
+    {
+        etl::StaticQueue<std::string, 4> queue;
+
+        std::string in[] = { std::string(50, 'a'), std::string(50, 'b'), std::string(50, 'c') };
+
+        size_t count = queue.enqueue(in, 3);
+        assert(count == 3);
+
+        std::string element;
+        bool success = queue.peek(element);
+        assert(success);
+        assert(element == in[0]);
+
+        std::string out[4];
+        count = queue.dequeue(out, 2);
+        assert(count == 2);
+        assert(out[0] == in[0] && out[1] == in[1]);
+
+        // Wraps around the end of the queue.
+        count = queue.enqueue(in, 3);
+        assert(count == 3);
+        assert(queue.full());
+
+        count = queue.drain(out);
+        assert(count == 4);
+        assert(out[0] == in[2] && out[1] == in[0] && out[2] == in[1] && out[3] == in[2]);
+    }
+
+    {
+        {
+            etl::Queue<Counted> queue(3);
+
+            queue.emplace(1);
+            queue.enqueue(Counted(2));
+            assert(Counted::alive == 2);
+
+            Counted element;
+            queue.dequeue(element);
+            assert(element.value == 1);
+            assert(Counted::alive == 2);
+        }
+
+        // The element left in the queue was destroyed with it.
+        assert(Counted::alive == 0);
+    }
+
+    {
+        etl::MpmcQueue<uint8_t> queue(4);
+
+        assert(queue.size() == 4);
+        assert(queue.empty());
+
+        uint8_t element;
+        bool success = queue.peek(element);
+        assert(!success);
+
+        for(uint8_t i = 0; i < 4; i++)
+        {
+            success = queue.enqueue(i);
+            assert(success);
+        }
+
+        assert(queue.full());
+        success = queue.enqueue(4);
+        assert(!success);
+
+        success = queue.peek(element);
+        assert(success);
+        assert(element == 0);
+        assert(queue.elements() == 4);
+
+        for(uint8_t i = 0; i < 4; i++)
+        {
+            success = queue.dequeue(element);
+            assert(success);
+            assert(element == i);
+        }
+
+        assert(queue.empty());
+        success = queue.dequeue(element);
+        assert(!success);
+    }
+
+    {
+        // The smallest queue, over several rounds of the sequence numbers.
+        etl::MpmcQueue<uint8_t> queue(2);
+
+        for(uint8_t round = 0; round < 4; round++)
+        {
+            bool success = queue.enqueue(round);
+            assert(success);
+            success = queue.enqueue(round + 1);
+            assert(success);
+            success = queue.enqueue(round + 2);
+            assert(!success);
+
+            uint8_t element;
+            success = queue.dequeue(element);
+            assert(success);
+            assert(element == round);
+            success = queue.dequeue(element);
+            assert(success);
+            assert(element == round + 1);
+            success = queue.dequeue(element);
+            assert(!success);
+        }
+    }
+
+    {
+        etl::MpmcQueue<std::string> queue(2);
+
+        bool success = queue.enqueue(std::string(100, 'a'));
+        assert(success);
+        success = queue.enqueue(std::string(100, 'b'));
+        assert(success);
+
+        std::string element;
+        success = queue.dequeue(element);
+        assert(success);
+        assert(element == std::string(100, 'a'));
+
+        // The remaining element is destroyed with the queue.
+    }
+
+    {
+        etl::MpmcQueue<uint32_t> queue(64);
+
+        const uint32_t threads = 8;
+        const uint32_t count = 20000;
+
+        std::vector<std::thread> producers;
+        for(uint32_t p = 0; p < threads; p++)
+        {
+            producers.emplace_back([&queue, p]()
+            {
+                for(uint32_t i = 0; i < count; )
+                {
+                    if(queue.enqueue(p * count + i))
+                    {
+                        i++;
+                    }
+                    else
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+
+        std::atomic<uint32_t> dequeued = 0;
+        std::vector<std::vector<uint32_t>> received(threads);
+        std::vector<std::thread> consumers;
+        for(uint32_t c = 0; c < threads; c++)
+        {
+            consumers.emplace_back([&queue, &dequeued, &received, c]()
+            {
+                while(dequeued.load() < threads * count)
+                {
+                    uint32_t element;
+                    if(queue.dequeue(element))
+                    {
+                        received[c].push_back(element);
+                        dequeued++;
+                    }
+                    else
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+
+        for(auto& producer : producers)
+        {
+            producer.join();
+        }
+
+        for(auto& consumer : consumers)
+        {
+            consumer.join();
+        }
+
+        assert(queue.empty());
+
+        std::vector<uint8_t> seen(threads * count, 0);
+        for(const auto& r : received)
+        {
+            // Elements of a single producer are received in order by every consumer.
+            std::vector<uint32_t> last(threads, 0);
+            for(uint32_t element : r)
+            {
+                assert(element < threads * count);
+                assert(seen[element] == 0);
+                seen[element] = 1;
+
+                uint32_t producer = element / count;
+                assert(element % count >= last[producer]);
+                last[producer] = element % count;
+            }
+        }
+
+        for(uint8_t s : seen)
+        {
+            assert(s == 1);
+        }
+    }
 }
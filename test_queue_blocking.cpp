@@ -0,0 +1,116 @@
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#define ETL_QUEUE_BLOCKING
+
+#include "queue.h"
+
+typedef etl::Queue<uint8_t> Queue;
+
+auto main() -> int
+{
+    {
+        Queue queue(2);
+
+        uint8_t element;
+        auto start = std::chrono::steady_clock::now();
+        bool success = queue.dequeueWait(element, std::chrono::milliseconds(10));
+        assert(!success);
+        assert(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(10));
+
+        queue.enqueueWait(1);
+        queue.enqueueWait(2);
+        assert(queue.full());
+
+        success = queue.enqueueWait(3, std::chrono::milliseconds(10));
+        assert(!success);
+
+        success = queue.dequeueWait(element, std::chrono::milliseconds(10));
+        assert(success);
+        assert(element == 1);
+
+        success = queue.enqueueWait(3, std::chrono::milliseconds(10));
+        assert(success);
+    }
+
+    {
+        etl::Queue<uint32_t> queue(4);
+
+        const uint32_t count = 10000;
+
+        std::thread producer([&queue]()
+        {
+            for(uint32_t i = 0; i < count; i++)
+            {
+                queue.enqueueWait(i);
+
+                if(i % 1000 == 0)
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            }
+        });
+
+        for(uint32_t expected = 0; expected < count; expected++)
+        {
+            uint32_t element;
+            queue.dequeueWait(element);
+            assert(element == expected);
+
+            if(expected % 1000 == 500)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+
+        producer.join();
+
+        assert(queue.empty());
+    }
+
+    {
+        etl::Queue<std::unique_ptr<uint32_t>> queue(4);
+
+        const uint32_t count = 1000;
+
+        std::thread producer([&queue]()
+        {
+            for(uint32_t i = 0; i < count; i++)
+            {
+                queue.enqueueWait(std::make_unique<uint32_t>(i));
+            }
+        });
+
+        for(uint32_t expected = 0; expected < count; expected++)
+        {
+            std::unique_ptr<uint32_t> element;
+            queue.dequeueWait(element);
+            assert(*element == expected);
+        }
+
+        producer.join();
+    }
+
+    {
+        // A static queue wakes up its consumer too.
+        etl::StaticQueue<int, 4> queue;
+
+        std::thread producer([&queue]()
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            queue.enqueueWait(1);
+        });
+
+        int element = 0;
+        bool success = queue.dequeueWait(element, std::chrono::seconds(10));
+        assert(success);
+        assert(element == 1);
+
+        producer.join();
+    }
+}
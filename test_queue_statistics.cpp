@@ -0,0 +1,120 @@
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+
+static uint32_t ticks = 0;
+
+#define ETL_QUEUE_STATISTICS
+#define ETL_QUEUE_TIMESTAMP() (ticks)
+
+#include "queue.h"
+
+typedef etl::Queue<uint8_t> Queue;
+
+auto main() -> int
+{
+    {
+        Queue queue(3);
+
+        etl::QueueStatistics statistics = queue.statistics();
+        assert(statistics.enqueued == 0);
+        assert(statistics.dequeued == 0);
+        assert(statistics.highWater == 0);
+        assert(statistics.full == 0);
+        assert(statistics.empty == 0);
+
+        uint8_t element;
+        bool success = queue.dequeue(element);
+        assert(!success);
+
+        ticks = 100;
+        queue.enqueue(1);
+        queue.enqueue(2);
+
+        ticks = 101;
+        queue.enqueue(3);
+
+        success = queue.enqueue(4);
+        assert(!success);
+
+        statistics = queue.statistics();
+        assert(statistics.enqueued == 3);
+        assert(statistics.dequeued == 0);
+        assert(statistics.highWater == 3);
+        assert(statistics.full == 1);
+        assert(statistics.empty == 1);
+
+        ticks = 101;
+        queue.dequeue(element);
+        ticks = 104;
+        queue.dequeue(element);
+        queue.dequeue(element);
+
+        statistics = queue.statistics();
+        assert(statistics.enqueued == 3);
+        assert(statistics.dequeued == 3);
+        assert(statistics.highWater == 3);
+
+        // 1 tick, 4 ticks and 3 ticks.
+        assert(statistics.residency[0] == 0);
+        assert(statistics.residency[1] == 1);
+        assert(statistics.residency[2] == 1);
+        assert(statistics.residency[3] == 1);
+
+        // The high water mark stays.
+        queue.enqueue(5);
+        statistics = queue.statistics();
+        assert(statistics.highWater == 3);
+    }
+
+    {
+        etl::StaticQueue<std::string, 4> queue;
+
+        ticks = 0;
+
+        std::string in[] = { "a", "b", "c", "d", "e" };
+        size_t count = queue.enqueue(in, 5);
+        assert(count == 4);
+
+        std::string out[4];
+        count = queue.drain(out);
+        assert(count == 4);
+
+        count = queue.drain(out);
+        assert(count == 0);
+
+        etl::QueueStatistics statistics = queue.statistics();
+        assert(statistics.enqueued == 4);
+        assert(statistics.dequeued == 4);
+        assert(statistics.highWater == 4);
+        assert(statistics.full == 1);
+        assert(statistics.empty == 1);
+        assert(statistics.residency[0] == 4);
+    }
+
+    {
+        etl::StaticQueue<uint32_t, 8> queue;
+
+        size_t count = 4;
+        uint32_t* reserved = queue.reserve(count);
+        assert(reserved != nullptr);
+        queue.commit(2);
+
+        count = 8;
+        queue.acquire(count);
+        queue.release(count);
+
+        count = 1;
+        uint32_t* acquired = queue.acquire(count);
+        assert(acquired == nullptr);
+
+        etl::QueueStatistics statistics = queue.statistics();
+        assert(statistics.enqueued == 2);
+        assert(statistics.dequeued == 2);
+        assert(statistics.highWater == 2);
+        assert(statistics.empty == 1);
+    }
+}